@@ -0,0 +1,582 @@
+#include "DynamicFontAtlas.h"
+#include <algorithm>
+#include <cstring>
+#ifndef IMGUI_DEFINE_MATH_OPERATORS
+#define IMGUI_DEFINE_MATH_OPERATORS
+#endif
+#include "imgui_internal.h"
+#include "imgui_freetype.h"
+#include <GL/glew.h>
+#include "spdlog/spdlog.h"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+// -----------------------------
+//
+// -----------------------------
+struct DynamicFontAtlas::Source
+{
+	const ImFontConfig* cfg;
+	ImGuiFreeTypeRasterizer* rasterizer;
+	// GlyphOffset plus the rounded ascent of the destination font.
+	float offsetX;
+	float offsetY;
+};
+
+struct DynamicFontAtlas::Glyph
+{
+	ImWchar codepoint;
+	int source;
+	int width;
+	int height;
+	// Glyph quad and advance as ImFont::AddGlyph() takes them.
+	float x0;
+	float y0;
+	float advanceX;
+	// Top-left corner in the texture, -1 when the glyph is not packed.
+	int texX;
+	int texY;
+	ImU32 lastUsed;
+	// Preloaded glyphs are never evicted.
+	bool pinned;
+	std::vector<unsigned char> pixels;
+};
+
+struct DynamicFontAtlas::FontState
+{
+	DynamicFontAtlas* owner;
+	ImFont* font;
+	// Indices into DynamicFontAtlas::sources, in ConfigData order.
+	std::vector<int> sources;
+	// Same order as font->Glyphs (which has an extra TAB glyph at the end).
+	std::vector<Glyph> glyphs;
+	// ImFont::GlyphUseFrames.
+	std::vector<ImU32> useFrames;
+	// Codepoints already loaded, queued, or missing from the sources.
+	ImBitVector known;
+	std::vector<ImWchar> requests;
+	bool changed;
+};
+
+static bool inRanges(const ImWchar* ranges, ImWchar c)
+{
+	for (; ranges[0] && ranges[1]; ranges += 2)
+	{
+		if (c >= ranges[0] && c <= ranges[1])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+// -----------------------------
+//
+// -----------------------------
+DynamicFontAtlas::DynamicFontAtlas()
+{
+	atlas = nullptr;
+	texSize = 0;
+	reservedHeight = 0;
+	packContext = nullptr;
+	packNodes = nullptr;
+	frame = 0;
+	hasRequests = false;
+	evictedThisUpdate = false;
+	droppedThisUpdate = 0;
+	evictions = 0;
+	uploadedBytes = 0;
+	dirtyX0 = dirtyY0 = dirtyX1 = dirtyY1 = 0;
+}
+
+DynamicFontAtlas::~DynamicFontAtlas()
+{
+	for (size_t i = 0; i < fonts.size(); ++i)
+	{
+		ImFont* font = fonts[i]->font;
+		font->MissingGlyphCallback = NULL;
+		font->MissingGlyphUserData = NULL;
+		font->GlyphUseFrames = NULL;
+		delete fonts[i];
+	}
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		ImGuiFreeType::DestroyRasterizer(sources[i].rasterizer);
+	}
+	delete packContext;
+	delete[] packNodes;
+}
+
+bool DynamicFontAtlas::Build(ImFontAtlas* atlas, int texSize, const ImWchar* preloadRanges)
+{
+	IM_ASSERT(atlas->ConfigData.Size > 0);
+	IM_ASSERT(this->atlas == nullptr && "Build() may be called once");
+	this->atlas = atlas;
+	this->texSize = texSize;
+
+	// Texture: custom rects first, in a band at the top that repacking keeps.
+	ImFontAtlasBuildInit(atlas);
+	atlas->TexID = (ImTextureID)NULL;
+	atlas->ClearTexData();
+	atlas->TexWidth = texSize;
+	atlas->TexHeight = texSize;
+	atlas->TexUvScale = ImVec2(1.0f / texSize, 1.0f / texSize);
+	atlas->TexPixelsAlpha8 = (unsigned char*)IM_ALLOC((size_t)texSize * texSize);
+	memset(atlas->TexPixelsAlpha8, 0, (size_t)texSize * texSize);
+
+	packContext = new stbrp_context;
+	packNodes = new stbrp_node[texSize];
+	stbrp_init_target(packContext, texSize, texSize, packNodes, texSize);
+	ImFontAtlasBuildPackCustomRects(atlas, packContext);
+	for (int i = 0; i < atlas->CustomRects.Size; ++i)
+	{
+		const ImFontAtlasCustomRect& r = atlas->CustomRects[i];
+		if (!r.IsPacked())
+		{
+			spdlog::error((const char*)u8"Dynamic font atlas: {0}x{0} is too small for the custom rects.", texSize);
+			return false;
+		}
+		reservedHeight = ImMax(reservedHeight, r.Y + r.Height + atlas->TexGlyphPadding);
+	}
+	resetPacker();
+
+	// One rasterizer per source font.
+	for (int i = 0; i < atlas->ConfigData.Size; ++i)
+	{
+		ImFontConfig& cfg = atlas->ConfigData[i];
+		Source source;
+		source.cfg = &cfg;
+		source.rasterizer = ImGuiFreeType::CreateRasterizer(&cfg, atlas->FontBuilderFlags);
+		source.offsetX = 0;
+		source.offsetY = 0;
+		if (source.rasterizer == nullptr)
+		{
+			spdlog::error((const char*)u8"Dynamic font atlas: cannot load font {0}.", cfg.Name);
+			return false;
+		}
+		float ascent;
+		float descent;
+		ImGuiFreeType::GetRasterizerMetrics(source.rasterizer, &ascent, &descent);
+		ImFontAtlasBuildSetupFont(atlas, cfg.DstFont, &cfg, ascent, descent);
+		sources.push_back(source);
+	}
+	for (int i = 0; i < atlas->Fonts.Size; ++i)
+	{
+		FontState* state = new FontState();
+		state->owner = this;
+		state->font = atlas->Fonts[i];
+		state->known.Create(IM_UNICODE_CODEPOINT_MAX + 1);
+		state->changed = true;
+		for (size_t s = 0; s < sources.size(); ++s)
+		{
+			if (sources[s].cfg->DstFont == state->font)
+			{
+				// Same placement as the FreeType builder.
+				sources[s].offsetX = sources[s].cfg->GlyphOffset.x;
+				sources[s].offsetY = sources[s].cfg->GlyphOffset.y + IM_ROUND(state->font->Ascent);
+				state->sources.push_back((int)s);
+			}
+		}
+		fonts.push_back(state);
+	}
+
+	// Preloaded glyphs, plus the ones ImFont::BuildLookupTable() picks the
+	// fallback and ellipsis characters from.
+	static const ImWchar special_chars[] = { (ImWchar)IM_UNICODE_CODEPOINT_INVALID, (ImWchar)'?', (ImWchar)' ', (ImWchar)0x2026, (ImWchar)0x0085, (ImWchar)'.', (ImWchar)0xFF0E };
+	for (size_t f = 0; f < fonts.size(); ++f)
+	{
+		for (int i = 0; i < IM_ARRAYSIZE(special_chars); ++i)
+		{
+			addGlyph(*fonts[f], special_chars[i], true);
+		}
+		for (const ImWchar* range = preloadRanges; range != nullptr && range[0] && range[1]; range += 2)
+		{
+			for (unsigned int c = range[0]; c <= range[1]; ++c)
+			{
+				if (!fonts[f]->known.TestBit((int)c))
+				{
+					addGlyph(*fonts[f], (ImWchar)c, true);
+				}
+			}
+		}
+		rebuildFont(*fonts[f]);
+	}
+	ImFontAtlasBuildFinish(atlas);
+	{
+		std::lock_guard<std::mutex> lock(pixelsMutex);
+		markDirty(0, 0, texSize, texSize);
+	}
+	spdlog::info((const char*)u8"Dynamic font atlas: {0} glyphs preloaded.", GlyphCount());
+	return true;
+}
+
+int DynamicFontAtlas::GlyphCount(void) const
+{
+	int count = 0;
+	for (size_t i = 0; i < fonts.size(); ++i)
+	{
+		count += (int)fonts[i]->glyphs.size();
+	}
+	return count;
+}
+
+// -----------------------------
+// ImFont::FindGlyph() hook, GUI thread inside the frame.
+// -----------------------------
+void DynamicFontAtlas::missingGlyph(const ImFont* font, ImWchar c)
+{
+	FontState* state = (FontState*)font->MissingGlyphUserData;
+	if (state->known.TestBit(c))
+	{
+		return;
+	}
+	state->known.SetBit(c);
+	state->requests.push_back(c);
+	state->owner->hasRequests = true;
+}
+
+bool DynamicFontAtlas::Update(void)
+{
+	if (atlas == nullptr)
+	{
+		return false;
+	}
+	bool changed = false;
+	if (hasRequests)
+	{
+		evictedThisUpdate = false;
+		droppedThisUpdate = 0;
+		// Glyphs drawn since the last rebuild, for the eviction order.
+		for (size_t f = 0; f < fonts.size(); ++f)
+		{
+			FontState& state = *fonts[f];
+			for (size_t i = 0; i < state.glyphs.size() && i < state.useFrames.size(); ++i)
+			{
+				state.glyphs[i].lastUsed = state.useFrames[i];
+			}
+		}
+		for (size_t f = 0; f < fonts.size(); ++f)
+		{
+			FontState& state = *fonts[f];
+			for (size_t i = 0; i < state.requests.size(); ++i)
+			{
+				addGlyph(state, state.requests[i], false);
+			}
+			state.requests.clear();
+		}
+		if (droppedThisUpdate > 0)
+		{
+			spdlog::warn((const char*)u8"Dynamic font atlas: no room for {0} glyphs.", droppedThisUpdate);
+		}
+		for (size_t f = 0; f < fonts.size(); ++f)
+		{
+			if (fonts[f]->changed)
+			{
+				rebuildFont(*fonts[f]);
+				changed = true;
+			}
+		}
+		hasRequests = false;
+	}
+	++frame;
+	for (size_t f = 0; f < fonts.size(); ++f)
+	{
+		fonts[f]->font->GlyphUseFrame = frame;
+	}
+	return changed;
+}
+
+int DynamicFontAtlas::findSource(const FontState& state, ImWchar c) const
+{
+	// First source that has the glyph wins, like in the FreeType builder.
+	for (size_t i = 0; i < state.sources.size(); ++i)
+	{
+		const Source& source = sources[state.sources[i]];
+		const ImWchar* ranges = source.cfg->GlyphRanges ? source.cfg->GlyphRanges : atlas->GetGlyphRangesDefault();
+		if (inRanges(ranges, c) && ImGuiFreeType::HasGlyph(source.rasterizer, c))
+		{
+			return state.sources[i];
+		}
+	}
+	return -1;
+}
+
+bool DynamicFontAtlas::addGlyph(FontState& state, ImWchar c, bool pinned)
+{
+	state.known.SetBit(c);
+	int sourceIndex = findSource(state, c);
+	if (sourceIndex < 0)
+	{
+		return false;
+	}
+	const Source& source = sources[sourceIndex];
+	ImGuiFreeTypeGlyph bitmap;
+	if (!ImGuiFreeType::RasterizeGlyph(source.rasterizer, c, &bitmap))
+	{
+		return false;
+	}
+	Glyph glyph;
+	glyph.codepoint = c;
+	glyph.source = sourceIndex;
+	glyph.width = bitmap.Width;
+	glyph.height = bitmap.Height;
+	glyph.x0 = bitmap.OffsetX + source.offsetX;
+	glyph.y0 = bitmap.OffsetY + source.offsetY;
+	glyph.advanceX = bitmap.AdvanceX;
+	glyph.texX = -1;
+	glyph.texY = -1;
+	glyph.lastUsed = frame;
+	glyph.pinned = pinned;
+	glyph.pixels.assign(bitmap.Pixels.begin(), bitmap.Pixels.end());
+	if (!pack(glyph))
+	{
+		// One repack per Update(): when the glyphs of a single frame do not
+		// fit, the rest of them stay as fallback characters.
+		if (evictedThisUpdate)
+		{
+			++droppedThisUpdate;
+			return false;
+		}
+		evict();
+		evictedThisUpdate = true;
+		if (!pack(glyph))
+		{
+			++droppedThisUpdate;
+			return false;
+		}
+	}
+	blit(glyph);
+	state.glyphs.push_back(std::move(glyph));
+	state.changed = true;
+	return true;
+}
+
+bool DynamicFontAtlas::pack(Glyph& glyph)
+{
+	if (glyph.width == 0 || glyph.height == 0)
+	{
+		// Blank glyph (space): no texels needed.
+		glyph.texX = 0;
+		glyph.texY = 0;
+		return true;
+	}
+	const int padding = atlas->TexGlyphPadding;
+	stbrp_rect rect;
+	memset(&rect, 0, sizeof(rect));
+	rect.w = (stbrp_coord)(glyph.width + padding);
+	rect.h = (stbrp_coord)(glyph.height + padding);
+	stbrp_pack_rects(packContext, &rect, 1);
+	if (!rect.was_packed)
+	{
+		return false;
+	}
+	glyph.texX = rect.x + padding;
+	glyph.texY = rect.y + padding;
+	return true;
+}
+
+void DynamicFontAtlas::blit(const Glyph& glyph)
+{
+	if (glyph.width == 0 || glyph.height == 0)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(pixelsMutex);
+	const unsigned char* src = glyph.pixels.data();
+	unsigned char* dst = atlas->TexPixelsAlpha8 + (size_t)glyph.texY * texSize + glyph.texX;
+	for (int y = 0; y < glyph.height; ++y, src += glyph.width, dst += texSize)
+	{
+		memcpy(dst, src, (size_t)glyph.width);
+	}
+	markDirty(glyph.texX, glyph.texY, glyph.texX + glyph.width, glyph.texY + glyph.height);
+}
+
+void DynamicFontAtlas::resetPacker(void)
+{
+	// The reserved band goes first, the skyline packer puts it at (0, 0).
+	stbrp_init_target(packContext, texSize, texSize, packNodes, texSize);
+	stbrp_rect band;
+	memset(&band, 0, sizeof(band));
+	band.w = (stbrp_coord)texSize;
+	band.h = (stbrp_coord)reservedHeight;
+	stbrp_pack_rects(packContext, &band, 1);
+	IM_ASSERT(band.was_packed && band.x == 0 && band.y == 0);
+}
+
+// -----------------------------
+// Repacks the texture, keeping the pinned glyphs, the ones drawn by the
+// last frame and then the most recently used ones until half of the
+// glyph area is taken. The rest is dropped and rasterized again on use.
+// In the pipelined mode a frame already submitted with the old layout
+// may be drawn once with the repacked texture.
+// -----------------------------
+void DynamicFontAtlas::evict(void)
+{
+	struct Entry
+	{
+		FontState* state;
+		size_t index;
+	};
+	std::vector<Entry> entries;
+	for (size_t f = 0; f < fonts.size(); ++f)
+	{
+		for (size_t i = 0; i < fonts[f]->glyphs.size(); ++i)
+		{
+			Entry entry = { fonts[f], i };
+			entries.push_back(entry);
+		}
+	}
+	const ImU32 currentFrame = frame;
+	std::stable_sort(entries.begin(), entries.end(), [currentFrame](const Entry& a, const Entry& b)
+		{
+			const Glyph& ga = a.state->glyphs[a.index];
+			const Glyph& gb = b.state->glyphs[b.index];
+			bool keepA = ga.pinned || ga.lastUsed == currentFrame;
+			bool keepB = gb.pinned || gb.lastUsed == currentFrame;
+			if (keepA != keepB)
+			{
+				return keepA;
+			}
+			return ga.lastUsed > gb.lastUsed;
+		});
+
+	{
+		std::lock_guard<std::mutex> lock(pixelsMutex);
+		memset(atlas->TexPixelsAlpha8 + (size_t)reservedHeight * texSize, 0, (size_t)(texSize - reservedHeight) * texSize);
+	}
+	resetPacker();
+	const int padding = atlas->TexGlyphPadding;
+	const size_t budget = (size_t)texSize * (texSize - reservedHeight) / 2;
+	size_t used = 0;
+	int dropped = 0;
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		Glyph& glyph = entries[i].state->glyphs[entries[i].index];
+		bool keep = glyph.pinned || glyph.lastUsed == currentFrame;
+		size_t area = (size_t)(glyph.width + padding) * (glyph.height + padding);
+		if ((keep || used + area <= budget) && pack(glyph))
+		{
+			blit(glyph);
+			used += area;
+		}
+		else
+		{
+			glyph.texX = -1;
+			++dropped;
+		}
+	}
+
+	for (size_t f = 0; f < fonts.size(); ++f)
+	{
+		FontState& state = *fonts[f];
+		state.glyphs.erase(std::remove_if(state.glyphs.begin(), state.glyphs.end(), [](const Glyph& g) { return g.texX < 0; }), state.glyphs.end());
+		// Dropped glyphs and codepoints missing from the fonts may be asked for again.
+		state.known.Create(IM_UNICODE_CODEPOINT_MAX + 1);
+		for (size_t i = 0; i < state.glyphs.size(); ++i)
+		{
+			state.known.SetBit(state.glyphs[i].codepoint);
+		}
+		for (size_t i = 0; i < state.requests.size(); ++i)
+		{
+			state.known.SetBit(state.requests[i]);
+		}
+		state.changed = true;
+	}
+	{
+		std::lock_guard<std::mutex> lock(pixelsMutex);
+		markDirty(0, reservedHeight, texSize, texSize);
+	}
+	++evictions;
+	spdlog::info((const char*)u8"Dynamic font atlas full: {0} glyphs evicted, {1} kept.", dropped, GlyphCount());
+}
+
+void DynamicFontAtlas::rebuildFont(FontState& state)
+{
+	ImFont* font = state.font;
+	// No hooks while the glyph array is rebuilt (BuildLookupTable calls FindGlyph).
+	font->MissingGlyphCallback = NULL;
+	font->GlyphUseFrames = NULL;
+	font->Glyphs.resize(0);
+	font->MetricsTotalSurface = 0;
+	const float uvScale = 1.0f / texSize;
+	for (size_t i = 0; i < state.glyphs.size(); ++i)
+	{
+		const Glyph& glyph = state.glyphs[i];
+		float x1 = glyph.x0 + glyph.width;
+		float y1 = glyph.y0 + glyph.height;
+		float u0 = glyph.texX * uvScale;
+		float v0 = glyph.texY * uvScale;
+		float u1 = (glyph.texX + glyph.width) * uvScale;
+		float v1 = (glyph.texY + glyph.height) * uvScale;
+		font->AddGlyph(sources[glyph.source].cfg, glyph.codepoint, glyph.x0, glyph.y0, x1, y1, u0, v0, u1, v1, glyph.advanceX);
+	}
+	font->BuildLookupTable();
+	state.useFrames.resize(font->Glyphs.Size);
+	for (int i = 0; i < font->Glyphs.Size; ++i)
+	{
+		state.useFrames[i] = (i < (int)state.glyphs.size()) ? state.glyphs[i].lastUsed : frame;
+	}
+	font->GlyphUseFrames = state.useFrames.data();
+	font->GlyphUseFrame = frame;
+	font->MissingGlyphCallback = missingGlyph;
+	font->MissingGlyphUserData = &state;
+	state.changed = false;
+}
+
+// Called with pixelsMutex held.
+void DynamicFontAtlas::markDirty(int x0, int y0, int x1, int y1)
+{
+	if (dirtyX1 <= dirtyX0 || dirtyY1 <= dirtyY0)
+	{
+		dirtyX0 = x0;
+		dirtyY0 = y0;
+		dirtyX1 = x1;
+		dirtyY1 = y1;
+		return;
+	}
+	dirtyX0 = ImMin(dirtyX0, x0);
+	dirtyY0 = ImMin(dirtyY0, y0);
+	dirtyX1 = ImMax(dirtyX1, x1);
+	dirtyY1 = ImMax(dirtyY1, y1);
+}
+
+void DynamicFontAtlas::UploadDirty(void)
+{
+	std::lock_guard<std::mutex> lock(pixelsMutex);
+	if (atlas == nullptr || atlas->TexID == (ImTextureID)NULL)
+	{
+		// The backend creates the texture from the whole atlas.
+		return;
+	}
+	if (atlas->TexPixelsRGBA32 != NULL)
+	{
+		// RGBA copy made by the backend for the initial upload, not needed any more.
+		IM_FREE(atlas->TexPixelsRGBA32);
+		atlas->TexPixelsRGBA32 = NULL;
+	}
+	if (dirtyX1 <= dirtyX0 || dirtyY1 <= dirtyY0)
+	{
+		return;
+	}
+	const int width = dirtyX1 - dirtyX0;
+	const int height = dirtyY1 - dirtyY0;
+	uploadBuffer.resize((size_t)width * height);
+	for (int y = 0; y < height; ++y)
+	{
+		const unsigned char* src = atlas->TexPixelsAlpha8 + (size_t)(dirtyY0 + y) * texSize + dirtyX0;
+		uint32_t* dst = uploadBuffer.data() + (size_t)y * width;
+		for (int x = 0; x < width; ++x)
+		{
+			dst[x] = IM_COL32(255, 255, 255, src[x]);
+		}
+	}
+	GLint lastTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &lastTexture);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)atlas->TexID);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, dirtyX0, dirtyY0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, uploadBuffer.data());
+	glBindTexture(GL_TEXTURE_2D, (GLuint)lastTexture);
+	uploadedBytes += (size_t)width * height * 4;
+	dirtyX0 = dirtyY0 = dirtyX1 = dirtyY1 = 0;
+}
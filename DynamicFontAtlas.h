@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "imgui.h"
+
+struct ImGuiFreeTypeRasterizer;
+struct stbrp_context;
+struct stbrp_node;
+
+// -----------------------------
+// Font atlas filled on demand. Build() replaces ImFontAtlas::Build() for
+// the fonts added with AddFont*(): only preloadRanges are rasterized up
+// front, any other glyph of the fonts' GlyphRanges is rasterized through
+// imgui_freetype the first time ImFont::FindGlyph() misses it, packed into
+// the free space of a fixed size texture and uploaded as a sub-rectangle.
+// When the texture is full the least recently drawn glyphs are evicted.
+// A new glyph shows as the fallback character for the frame that asked
+// for it. Glyphs are stored as alpha only; custom rect glyphs
+// (AddCustomRectFontGlyph) are not supported.
+// -----------------------------
+class DynamicFontAtlas
+{
+public:
+	DynamicFontAtlas();
+	~DynamicFontAtlas();
+
+	// texSize x texSize texture. Call after the AddFont*() calls and
+	// before the backend creates the font texture.
+	bool Build(ImFontAtlas* atlas, int texSize, const ImWchar* preloadRanges);
+	// GUI thread, outside NewFrame()/Render(): rasterizes the glyphs the
+	// last frame asked for. Returns true when the fonts changed.
+	bool Update(void);
+	// Glyphs were requested since the last Update(), the next frame
+	// should be drawn soon.
+	bool HasRequests(void) const { return hasRequests; }
+	// Thread owning the GL context, before drawing: uploads the changed
+	// part of the texture with glTexSubImage2D.
+	void UploadDirty(void);
+
+	int GlyphCount(void) const;
+	int EvictionCount(void) const { return evictions; }
+	size_t UploadedBytes(void) const { return uploadedBytes; }
+
+private:
+	struct Source;
+	struct Glyph;
+	struct FontState;
+
+	static void missingGlyph(const ImFont* font, ImWchar c);
+	int findSource(const FontState& state, ImWchar c) const;
+	bool addGlyph(FontState& state, ImWchar c, bool pinned);
+	bool pack(Glyph& glyph);
+	void blit(const Glyph& glyph);
+	void evict(void);
+	void resetPacker(void);
+	void rebuildFont(FontState& state);
+	void markDirty(int x0, int y0, int x1, int y1);
+
+	ImFontAtlas* atlas;
+	int texSize;
+	// Rows taken by the atlas custom rects (white pixel, cursors, lines),
+	// kept in place when the glyphs are repacked.
+	int reservedHeight;
+	stbrp_context* packContext;
+	stbrp_node* packNodes;
+	std::vector<Source> sources;
+	std::vector<FontState*> fonts;
+	ImU32 frame;
+	bool hasRequests;
+	bool evictedThisUpdate;
+	int droppedThisUpdate;
+	int evictions;
+	size_t uploadedBytes;
+
+	// Guards the texture pixels and the dirty rectangle, which the render
+	// thread reads in UploadDirty() in the pipelined mode.
+	std::mutex pixelsMutex;
+	int dirtyX0, dirtyY0, dirtyX1, dirtyY1;
+	std::vector<uint32_t> uploadBuffer;
+};
@@ -0,0 +1,728 @@
+#include "EventBridge.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+typedef SOCKET NativeSocket;
+typedef WSAPOLLFD PollFd;
+typedef WSABUF GatherBuffer;
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int NativeSocket;
+typedef struct pollfd PollFd;
+typedef struct iovec GatherBuffer;
+#endif
+#include "events.h"
+
+#pragma pack(push, 1)
+struct BridgeFrameHeader
+{
+	// Bytes after this field.
+	uint32_t length;
+	uint16_t type;
+};
+struct BridgeEnqueueRecord
+{
+	int32_t type;
+	int32_t code;
+	int32_t priority;
+};
+struct BridgeAck
+{
+	BridgeFrameHeader header;
+	uint32_t queued;
+	uint32_t dropped;
+};
+struct BridgeUpdateHeader
+{
+	BridgeFrameHeader header;
+	int32_t kind;
+	int32_t code;
+};
+#pragma pack(pop)
+
+static const intptr_t NO_SOCKET = -1;
+// Buffers per gather write, below IOV_MAX.
+static const int GATHER_BUFFERS = 512;
+
+// -----------------------------
+// Sockets of Windows (AF_UNIX since Windows 10) and POSIX.
+// -----------------------------
+static void closeSocket(intptr_t socket)
+{
+	if (socket != NO_SOCKET)
+	{
+#ifdef _WIN32
+		closesocket((NativeSocket)socket);
+#else
+		close((NativeSocket)socket);
+#endif
+	}
+}
+
+static bool wouldBlock(void)
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static void setNonBlocking(intptr_t socket)
+{
+#ifdef _WIN32
+	u_long on = 1;
+	ioctlsocket((NativeSocket)socket, FIONBIO, &on);
+#else
+	fcntl((NativeSocket)socket, F_SETFL, fcntl((NativeSocket)socket, F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+static void removeSocketFile(const std::string& path)
+{
+#ifdef _WIN32
+	DeleteFileA(path.c_str());
+#else
+	unlink(path.c_str());
+#endif
+}
+
+static bool makeAddress(const std::string& path, sockaddr_un& address)
+{
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+	memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	return true;
+}
+
+static intptr_t connectSocket(const std::string& path)
+{
+	sockaddr_un address;
+	if (!makeAddress(path, address))
+	{
+		return NO_SOCKET;
+	}
+	NativeSocket s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((intptr_t)s == NO_SOCKET)
+	{
+		return NO_SOCKET;
+	}
+	if (connect(s, (sockaddr*)&address, sizeof(address)) != 0)
+	{
+		closeSocket((intptr_t)s);
+		return NO_SOCKET;
+	}
+	return (intptr_t)s;
+}
+
+// Bytes received, 0 when the peer closed, -1 on error or nothing to read.
+static long long receiveSome(intptr_t socket, char* buffer, size_t size)
+{
+	return (long long)recv((NativeSocket)socket, buffer, (int)size, 0);
+}
+
+static void setBuffer(GatherBuffer& buffer, const void* data, size_t size)
+{
+#ifdef _WIN32
+	buffer.buf = (CHAR*)data;
+	buffer.len = (ULONG)size;
+#else
+	buffer.iov_base = (void*)data;
+	buffer.iov_len = size;
+#endif
+}
+
+static size_t bufferSize(const GatherBuffer& buffer)
+{
+#ifdef _WIN32
+	return buffer.len;
+#else
+	return buffer.iov_len;
+#endif
+}
+
+static const char* bufferData(const GatherBuffer& buffer)
+{
+#ifdef _WIN32
+	return buffer.buf;
+#else
+	return (const char*)buffer.iov_base;
+#endif
+}
+
+// One writev; bytes sent, 0 when the socket is full, -1 on error.
+static long long sendGather(intptr_t socket, GatherBuffer* buffers, int count)
+{
+#ifdef _WIN32
+	DWORD bytes = 0;
+	if (WSASend((NativeSocket)socket, buffers, (DWORD)count, &bytes, 0, nullptr, nullptr) != 0)
+	{
+		return wouldBlock() ? 0 : -1;
+	}
+	return (long long)bytes;
+#else
+	// sendmsg is writev with flags: a closed peer must not raise SIGPIPE.
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = buffers;
+	message.msg_iovlen = (size_t)count;
+#ifdef MSG_NOSIGNAL
+	ssize_t bytes = sendmsg((NativeSocket)socket, &message, MSG_NOSIGNAL);
+#else
+	ssize_t bytes = sendmsg((NativeSocket)socket, &message, 0);
+#endif
+	if (bytes < 0)
+	{
+		return wouldBlock() ? 0 : -1;
+	}
+	return (long long)bytes;
+#endif
+}
+
+// Sends buffers in GATHER_BUFFERS batches; what the socket does not take
+// is appended to rest. False on error.
+static bool sendAll(intptr_t socket, std::vector<GatherBuffer>& buffers, std::vector<char>& rest)
+{
+	size_t first = 0;
+	while (first < buffers.size())
+	{
+		int count = (int)std::min(buffers.size() - first, (size_t)GATHER_BUFFERS);
+		long long bytes = sendGather(socket, &buffers[first], count);
+		if (bytes < 0)
+		{
+			return false;
+		}
+		if (bytes == 0)
+		{
+			// The socket is full.
+			break;
+		}
+		// Skip what was sent; a partly sent buffer keeps its tail.
+		while (first < buffers.size() && bytes >= (long long)bufferSize(buffers[first]))
+		{
+			bytes -= (long long)bufferSize(buffers[first]);
+			++first;
+		}
+		if (bytes > 0)
+		{
+			setBuffer(buffers[first], bufferData(buffers[first]) + bytes, bufferSize(buffers[first]) - (size_t)bytes);
+		}
+	}
+	for (; first < buffers.size(); ++first)
+	{
+		rest.insert(rest.end(), bufferData(buffers[first]), bufferData(buffers[first]) + bufferSize(buffers[first]));
+	}
+	return true;
+}
+
+// -----------------------------
+//
+// -----------------------------
+EventBridge::EventBridge(Events& events)
+	: events(events), listener(NO_SOCKET), wakeReader(NO_SOCKET), wakeWriter(NO_SOCKET),
+	running(false), needStop(false), subscribers(0), queued(0), sent(0)
+{
+}
+
+EventBridge::~EventBridge()
+{
+	Stop();
+}
+
+bool EventBridge::Start(const char* path)
+{
+	Stop();
+	this->path = path;
+	sockaddr_un address;
+	if (!makeAddress(this->path, address))
+	{
+		spdlog::warn("Event bridge path {} is too long.", this->path);
+		return false;
+	}
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+	{
+		return false;
+	}
+#endif
+	removeSocketFile(this->path);
+	NativeSocket s = socket(AF_UNIX, SOCK_STREAM, 0);
+	listener = (intptr_t)s;
+	if (listener == NO_SOCKET)
+	{
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return false;
+	}
+	// The socket is owner only before listen() lets anyone connect.
+	if (bind(s, (sockaddr*)&address, sizeof(address)) != 0
+#ifndef _WIN32
+		|| chmod(this->path.c_str(), S_IRUSR | S_IWUSR) != 0
+#endif
+		|| listen(s, 16) != 0)
+	{
+		spdlog::warn("Cannot serve the event bridge on {}.", this->path);
+		Stop();
+		return false;
+	}
+	// The wake connection is the first one the listener accepts.
+	wakeWriter = connectSocket(this->path);
+	wakeReader = wakeWriter != NO_SOCKET ? (intptr_t)accept(s, nullptr, nullptr) : NO_SOCKET;
+	if (wakeReader == NO_SOCKET)
+	{
+		Stop();
+		return false;
+	}
+	setNonBlocking(listener);
+	setNonBlocking(wakeReader);
+	setNonBlocking(wakeWriter);
+	needStop = false;
+	running = true;
+	thread = std::thread(&EventBridge::loop, this);
+	return true;
+}
+
+void EventBridge::Stop(void)
+{
+	if (thread.joinable())
+	{
+		needStop = true;
+		wake();
+		thread.join();
+	}
+	{
+		std::lock_guard<std::mutex> lock(updatesMutex);
+		running = false;
+		updates.clear();
+	}
+	for (Client& client : clients)
+	{
+		disconnect(client);
+	}
+	clients.clear();
+	closeSocket(wakeReader);
+	closeSocket(wakeWriter);
+	wakeReader = NO_SOCKET;
+	wakeWriter = NO_SOCKET;
+	if (listener != NO_SOCKET)
+	{
+		closeSocket(listener);
+		listener = NO_SOCKET;
+		removeSocketFile(path);
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+}
+
+void EventBridge::Post(const GuiUpdate& update)
+{
+	// Most updates are posted with nobody following them.
+	if (subscribers.load(std::memory_order_relaxed) == 0)
+	{
+		return;
+	}
+	// Under the lock: Stop() clears running under it before it closes
+	// wakeWriter, so the handle is still open here.
+	std::lock_guard<std::mutex> lock(updatesMutex);
+	if (!running)
+	{
+		return;
+	}
+	bool wasEmpty = updates.empty();
+	updates.push_back(update);
+	if (wasEmpty)
+	{
+		wake();
+	}
+}
+
+void EventBridge::wake(void)
+{
+	char byte = 0;
+	::send((NativeSocket)wakeWriter, &byte, 1, 0);
+}
+
+// -----------------------------
+//
+// -----------------------------
+void EventBridge::loop(void)
+{
+	std::vector<PollFd> polls;
+	std::vector<GuiUpdate> pending;
+	char drain[256];
+	while (!needStop)
+	{
+		polls.resize(2 + clients.size());
+		polls[0].fd = (NativeSocket)wakeReader;
+		polls[0].events = POLLIN;
+		polls[1].fd = (NativeSocket)listener;
+		polls[1].events = POLLIN;
+		for (size_t i = 0; i < clients.size(); ++i)
+		{
+			polls[2 + i].fd = (NativeSocket)clients[i].socket;
+			polls[2 + i].events = POLLIN | (clients[i].output.empty() ? 0 : POLLOUT);
+		}
+		for (PollFd& p : polls)
+		{
+			p.revents = 0;
+		}
+#ifdef _WIN32
+		WSAPoll(polls.data(), (ULONG)polls.size(), constants::EVENTS_WAIT_TIMEOUT_MS);
+#else
+		poll(polls.data(), (nfds_t)polls.size(), constants::EVENTS_WAIT_TIMEOUT_MS);
+#endif
+		if (polls[0].revents != 0)
+		{
+			while (receiveSome(wakeReader, drain, sizeof(drain)) > 0)
+			{
+			}
+		}
+		if (polls[1].revents != 0)
+		{
+			for (;;)
+			{
+				intptr_t s = (intptr_t)accept((NativeSocket)listener, nullptr, nullptr);
+				if (s == NO_SOCKET)
+				{
+					break;
+				}
+				setNonBlocking(s);
+				Client client;
+				client.socket = s;
+				client.subscribed = false;
+				clients.push_back(std::move(client));
+			}
+		}
+		// The clients accepted above have no poll entry yet.
+		size_t polled = polls.size() - 2;
+		for (size_t i = 0; i < polled; ++i)
+		{
+			if ((polls[2 + i].revents & (POLLIN | POLLHUP | POLLERR)) != 0 && !receive(clients[i]))
+			{
+				disconnect(clients[i]);
+			}
+		}
+		pending.clear();
+		{
+			std::lock_guard<std::mutex> lock(updatesMutex);
+			pending.swap(updates);
+		}
+		for (Client& client : clients)
+		{
+			if (client.socket != NO_SOCKET && !send(client, pending))
+			{
+				disconnect(client);
+			}
+		}
+		clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& client)
+		{
+			return client.socket == NO_SOCKET;
+		}), clients.end());
+	}
+}
+
+// Parses after each chunk, so input never holds more than a partial frame
+// of at most BRIDGE_MAX_FRAME_BYTES and a chunk. A pass reads at most one
+// frame's worth, poll() reports the rest on the next one.
+bool EventBridge::receive(Client& client)
+{
+	size_t received = 0;
+	while (received < (size_t)constants::BRIDGE_MAX_FRAME_BYTES)
+	{
+		size_t size = client.input.size();
+		client.input.resize(size + constants::BRIDGE_READ_CHUNK_BYTES);
+		long long bytes = receiveSome(client.socket, client.input.data() + size, constants::BRIDGE_READ_CHUNK_BYTES);
+		client.input.resize(size + (size_t)std::max(bytes, 0LL));
+		if (bytes == 0)
+		{
+			return false;
+		}
+		if (bytes < 0)
+		{
+			return wouldBlock();
+		}
+		if (!parse(client))
+		{
+			return false;
+		}
+		if (bytes < constants::BRIDGE_READ_CHUNK_BYTES)
+		{
+			return true;
+		}
+		received += (size_t)bytes;
+	}
+	return true;
+}
+
+bool EventBridge::parse(Client& client)
+{
+	size_t offset = 0;
+	while (client.input.size() - offset >= sizeof(BridgeFrameHeader))
+	{
+		BridgeFrameHeader header;
+		memcpy(&header, client.input.data() + offset, sizeof(header));
+		if (header.length < sizeof(header.type) || header.length > (uint32_t)constants::BRIDGE_MAX_FRAME_BYTES)
+		{
+			return false;
+		}
+		size_t frameSize = sizeof(header.length) + header.length;
+		if (client.input.size() - offset < frameSize)
+		{
+			break;
+		}
+		const char* body = client.input.data() + offset + sizeof(header);
+		size_t bodySize = frameSize - sizeof(header);
+		if (header.type == constants::BRIDGE_MSG_ENQUEUE)
+		{
+			uint32_t ok = 0;
+			uint32_t dropped = 0;
+			for (size_t i = 0; i + sizeof(BridgeEnqueueRecord) <= bodySize; i += sizeof(BridgeEnqueueRecord))
+			{
+				BridgeEnqueueRecord record;
+				memcpy(&record, body + i, sizeof(record));
+				MyEvent event(record.code, record.priority);
+				if (record.type == constants::EVENT_TYPE_GUI)
+				{
+					event.coalesceKey = Events::CoalesceKey(record.code);
+					event.orderingKey = Events::OrderingKey(record.code);
+				}
+				if (record.type >= 0 && record.type < constants::MAX_EVENT_TYPES && events.TryEnqueue(record.type, event))
+				{
+					++ok;
+				}
+				else
+				{
+					++dropped;
+				}
+			}
+			queued.fetch_add(ok, std::memory_order_relaxed);
+			client.acks.push_back(ok);
+			client.acks.push_back(dropped);
+		}
+		else if (header.type == constants::BRIDGE_MSG_SUBSCRIBE && !client.subscribed)
+		{
+			client.subscribed = true;
+			subscribers.fetch_add(1, std::memory_order_relaxed);
+		}
+		offset += frameSize;
+	}
+	client.input.erase(client.input.begin(), client.input.begin() + offset);
+	return true;
+}
+
+// The loop removes the client once its socket is NO_SOCKET.
+void EventBridge::disconnect(Client& client)
+{
+	closeSocket(client.socket);
+	client.socket = NO_SOCKET;
+	if (client.subscribed)
+	{
+		client.subscribed = false;
+		subscribers.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+bool EventBridge::send(Client& client, const std::vector<GuiUpdate>& updates)
+{
+	size_t updateCount = client.subscribed ? updates.size() : 0;
+	if (client.output.empty() && client.acks.empty() && updateCount == 0)
+	{
+		return true;
+	}
+	if (!client.output.empty())
+	{
+		// The socket took nothing new until the leftovers are out.
+		std::vector<GatherBuffer> buffers(1);
+		setBuffer(buffers[0], client.output.data(), client.output.size());
+		std::vector<char> rest;
+		if (!sendAll(client.socket, buffers, rest))
+		{
+			return false;
+		}
+		client.output.swap(rest);
+	}
+	std::vector<BridgeAck> acks(client.acks.size() / 2);
+	for (size_t i = 0; i < acks.size(); ++i)
+	{
+		acks[i].header.length = (uint32_t)(sizeof(BridgeAck) - sizeof(uint32_t));
+		acks[i].header.type = (uint16_t)constants::BRIDGE_MSG_ACK;
+		acks[i].queued = client.acks[2 * i];
+		acks[i].dropped = client.acks[2 * i + 1];
+	}
+	client.acks.clear();
+	std::vector<BridgeUpdateHeader> headers(updateCount);
+	std::vector<GatherBuffer> buffers;
+	buffers.reserve(acks.size() + 2 * updateCount);
+	for (const BridgeAck& ack : acks)
+	{
+		buffers.push_back(GatherBuffer());
+		setBuffer(buffers.back(), &ack, sizeof(ack));
+	}
+	for (size_t i = 0; i < updateCount; ++i)
+	{
+		size_t length = strlen(updates[i].text);
+		headers[i].header.length = (uint32_t)(sizeof(BridgeUpdateHeader) - sizeof(uint32_t) + length);
+		headers[i].header.type = (uint16_t)constants::BRIDGE_MSG_UPDATE;
+		headers[i].kind = updates[i].kind;
+		headers[i].code = updates[i].code;
+		buffers.push_back(GatherBuffer());
+		setBuffer(buffers.back(), &headers[i], sizeof(BridgeUpdateHeader));
+		if (length > 0)
+		{
+			buffers.push_back(GatherBuffer());
+			setBuffer(buffers.back(), updates[i].text, length);
+		}
+	}
+	sent.fetch_add(updateCount, std::memory_order_relaxed);
+	if (!client.output.empty())
+	{
+		// Keep the order: queue behind the leftovers.
+		for (const GatherBuffer& buffer : buffers)
+		{
+			client.output.insert(client.output.end(), bufferData(buffer), bufferData(buffer) + bufferSize(buffer));
+		}
+	}
+	else if (!sendAll(client.socket, buffers, client.output))
+	{
+		return false;
+	}
+	if (client.output.size() > (size_t)constants::BRIDGE_MAX_PENDING_BYTES)
+	{
+		spdlog::warn("Event bridge client does not read its replies, disconnected.");
+		return false;
+	}
+	return true;
+}
+
+// -----------------------------
+// Benchmark
+// -----------------------------
+void EventBridge::Benchmark(FILE* f)
+{
+	const int TOTAL = 1 << 20;
+	const int BATCH = 256;
+#ifdef _WIN32
+	char temp[MAX_PATH] = "";
+	GetTempPathA(MAX_PATH, temp);
+	std::string path = std::string(temp) + "imide-bridge-bench.sock";
+#else
+	std::string path = "/tmp/imide-bridge-bench.sock";
+#endif
+	Events events;
+	events.Run(0);
+	if (!events.bridge.Start(path.c_str()))
+	{
+		fprintf(f, "Cannot start the event bridge on %s\n", path.c_str());
+		events.Stop();
+		return;
+	}
+	intptr_t client = connectSocket(path);
+	if (client == NO_SOCKET)
+	{
+		fprintf(f, "Cannot connect to the event bridge on %s\n", path.c_str());
+		events.Stop();
+		return;
+	}
+	BridgeFrameHeader subscribe = { (uint32_t)sizeof(uint16_t), (uint16_t)constants::BRIDGE_MSG_SUBSCRIBE };
+	::send((NativeSocket)client, (const char*)&subscribe, sizeof(subscribe), 0);
+
+	// Reader: acks and the status update every dispatched command posts.
+	std::atomic<uint64_t> acked(0);
+	std::atomic<uint64_t> dropped(0);
+	std::atomic<uint64_t> updatesBack(0);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::thread reader([&]()
+	{
+		std::vector<char> input;
+		std::vector<char> chunk(constants::BRIDGE_READ_CHUNK_BYTES);
+		while (acked + dropped < (uint64_t)TOTAL || updatesBack < acked)
+		{
+			long long bytes = receiveSome(client, chunk.data(), chunk.size());
+			if (bytes <= 0)
+			{
+				break;
+			}
+			input.insert(input.end(), chunk.data(), chunk.data() + bytes);
+			size_t offset = 0;
+			while (input.size() - offset >= sizeof(BridgeFrameHeader))
+			{
+				BridgeFrameHeader header;
+				memcpy(&header, input.data() + offset, sizeof(header));
+				if (input.size() - offset < sizeof(uint32_t) + header.length)
+				{
+					break;
+				}
+				if (header.type == constants::BRIDGE_MSG_ACK)
+				{
+					BridgeAck ack;
+					memcpy(&ack, input.data() + offset, sizeof(ack));
+					acked += ack.queued;
+					dropped += ack.dropped;
+				}
+				else if (header.type == constants::BRIDGE_MSG_UPDATE)
+				{
+					++updatesBack;
+				}
+				offset += sizeof(uint32_t) + header.length;
+			}
+			input.erase(input.begin(), input.begin() + offset);
+		}
+	});
+
+	std::vector<char> frame(sizeof(BridgeFrameHeader) + BATCH * sizeof(BridgeEnqueueRecord));
+	BridgeFrameHeader header = { (uint32_t)(frame.size() - sizeof(uint32_t)), (uint16_t)constants::BRIDGE_MSG_ENQUEUE };
+	memcpy(frame.data(), &header, sizeof(header));
+	for (int i = 0; i < BATCH; ++i)
+	{
+		// Commands without a coalescing key, every one is dispatched.
+		BridgeEnqueueRecord record = { constants::EVENT_TYPE_GUI, constants::GUI_COMMAND_RUN + i % 3, 1 };
+		memcpy(frame.data() + sizeof(header) + i * sizeof(record), &record, sizeof(record));
+	}
+	for (int n = 0; n < TOTAL; n += BATCH)
+	{
+		// The bridge drops what the GUI bound has no room for, so keep at
+		// most a bound's worth of commands sent and not dispatched yet.
+		while ((uint64_t)n + BATCH - updatesBack - dropped > (uint64_t)constants::EVENT_QUEUE_CAPACITY_GUI)
+		{
+			std::this_thread::yield();
+		}
+		size_t offset = 0;
+		while (offset < frame.size())
+		{
+			long long bytes = (long long)::send((NativeSocket)client, frame.data() + offset, (int)(frame.size() - offset), 0);
+			if (bytes <= 0)
+			{
+				break;
+			}
+			offset += (size_t)bytes;
+		}
+	}
+	reader.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	closeSocket(client);
+	events.Stop();
+	fprintf(f, "Event bridge, %d commands in frames of %d over %s:\n", TOTAL, BATCH, path.c_str());
+	fprintf(f, "  commands queued     %10llu  %8.0f k/s\n", (unsigned long long)acked.load(), acked / seconds / 1000);
+	fprintf(f, "  commands dropped    %10llu\n", (unsigned long long)dropped.load());
+	fprintf(f, "  status updates back %10llu  %8.0f k/s\n", (unsigned long long)updatesBack.load(), updatesBack / seconds / 1000);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Events;
+struct GuiUpdate;
+
+// -----------------------------
+// Local IPC bridge: a thread serving a Unix domain socket, so scripts can
+// queue commands and follow the GUI updates (frames in constants.h,
+// BRIDGE_MSG_*). One poll() loop serves every client. Each pass parses
+// all the whole frames read, queues their events, then sends each client
+// its acks and the updates posted since the last pass in one gather
+// write, the update text straight from where Post() stored it. Only what
+// a full socket leaves over is copied, to be sent when it drains.
+// -----------------------------
+class EventBridge
+{
+public:
+	explicit EventBridge(Events& events);
+	~EventBridge();
+
+	// Removes a stale socket file at path first. The new one is only open
+	// to the owner.
+	bool Start(const char* path);
+	void Stop(void);
+	bool IsRunning(void) const { return running.load(std::memory_order_acquire); }
+	// Any thread: sends update to the subscribed clients, nothing when
+	// there are none.
+	void Post(const GuiUpdate& update);
+
+	uint64_t EventsQueued(void) const { return queued.load(std::memory_order_relaxed); }
+	uint64_t UpdatesSent(void) const { return sent.load(std::memory_order_relaxed); }
+
+	// Commands from a local client through a bridge to a new Events and
+	// the status updates back, messages per second.
+	static void Benchmark(FILE* f);
+
+private:
+	struct Client
+	{
+		intptr_t socket;
+		bool subscribed;
+		// Received, not a whole frame yet.
+		std::vector<char> input;
+		// What the last write could not send.
+		std::vector<char> output;
+		// { queued, dropped } of the ENQUEUE frames of this pass.
+		std::vector<uint32_t> acks;
+	};
+
+	void loop(void);
+	// False when the client has to be closed.
+	bool receive(Client& client);
+	bool parse(Client& client);
+	bool send(Client& client, const std::vector<GuiUpdate>& updates);
+	void wake(void);
+	void disconnect(Client& client);
+
+	Events& events;
+	std::string path;
+	intptr_t listener;
+	// A connection of the bridge to itself, Post() and Stop() write a byte
+	// to wake poll().
+	intptr_t wakeReader;
+	intptr_t wakeWriter;
+	std::vector<Client> clients;
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<bool> needStop;
+	// Clients that sent SUBSCRIBE; without any Post() returns at once.
+	std::atomic<int> subscribers;
+	std::mutex updatesMutex;
+	// Posted, not sent yet.
+	std::vector<GuiUpdate> updates;
+	std::atomic<uint64_t> queued;
+	std::atomic<uint64_t> sent;
+};
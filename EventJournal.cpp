@@ -0,0 +1,235 @@
+#include "EventJournal.h"
+#include <cstring>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char journalMagic[8] = { 'I', 'M', 'J', 'R', 'N', 'L', '0', '1' };
+
+// First 64 bytes of the file, the records follow.
+struct EventJournal::Header
+{
+	char magic[8];
+	uint32_t recordSize;
+	uint32_t reserved;
+	uint64_t capacity;
+	char padding[40];
+};
+
+EventJournal::EventJournal()
+	: header(nullptr), slots(nullptr), capacity(0), holes(0), next(0), dropped(0), wallBaseNs(0), mappedSize(0)
+{
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+#else
+	file = -1;
+#endif
+}
+
+EventJournal::~EventJournal()
+{
+	Close();
+}
+
+bool EventJournal::Open(const char* path, uint64_t capacity)
+{
+	static_assert(sizeof(Header) == 64, "EventJournal header must stay 64 bytes.");
+	Close();
+	// An existing journal: map it at its size, check it is one.
+	bool created = !map(path, 0, false);
+	if (!created
+		&& (mappedSize < sizeof(Header)
+			|| memcmp(header->magic, journalMagic, sizeof(journalMagic)) != 0
+			|| header->recordSize != sizeof(Slot)
+			|| mappedSize < sizeof(Header) + header->capacity * sizeof(Slot)))
+	{
+		Close();
+		return false;
+	}
+	if (created)
+	{
+		if (capacity == 0 || !map(path, sizeof(Header) + capacity * sizeof(Slot), true))
+		{
+			return false;
+		}
+		memcpy(header->magic, journalMagic, sizeof(journalMagic));
+		header->recordSize = sizeof(Slot);
+		header->capacity = capacity;
+	}
+	this->capacity = header->capacity;
+	slots = reinterpret_cast<Slot*>(reinterpret_cast<char*>(header) + sizeof(Header));
+	// Recovery: the journal ends after the last committed record, the
+	// uncommitted ones before it were being written when the writer died.
+	uint64_t end = 0;
+	uint64_t committed = 0;
+	for (uint64_t i = 0; !created && i < this->capacity; ++i)
+	{
+		if (slots[i].commit.load(std::memory_order_acquire) == i + 1)
+		{
+			end = i + 1;
+			++committed;
+		}
+	}
+	holes = end - committed;
+	next = end;
+	dropped = 0;
+	steadyBase = std::chrono::steady_clock::now();
+	wallBaseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	return true;
+}
+
+void EventJournal::Close(void)
+{
+	if (header != nullptr)
+	{
+#ifdef _WIN32
+		FlushViewOfFile(header, 0);
+		FlushFileBuffers(file);
+#else
+		msync(header, mappedSize, MS_SYNC);
+#endif
+	}
+	unmap();
+}
+
+bool EventJournal::Append(Record record, std::chrono::steady_clock::time_point time)
+{
+	uint64_t sequence = next.load(std::memory_order_relaxed);
+	do
+	{
+		if (sequence >= capacity)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+	} while (!next.compare_exchange_weak(sequence, sequence + 1, std::memory_order_relaxed));
+	record.sequence = sequence;
+	record.timeNs = wallBaseNs + std::chrono::duration_cast<std::chrono::nanoseconds>(time - steadyBase).count();
+	Slot& slot = slots[sequence];
+	slot.record = record;
+	slot.commit.store(sequence + 1, std::memory_order_release);
+	return true;
+}
+
+uint64_t EventJournal::Count(void) const
+{
+	return next.load(std::memory_order_acquire);
+}
+
+bool EventJournal::Read(uint64_t sequence, Record& record) const
+{
+	if (slots == nullptr || sequence >= capacity)
+	{
+		return false;
+	}
+	const Slot& slot = slots[sequence];
+	if (slot.commit.load(std::memory_order_acquire) != sequence + 1)
+	{
+		return false;
+	}
+	record = slot.record;
+	return true;
+}
+
+// size 0 maps the whole file; create makes or resizes it to size.
+bool EventJournal::map(const char* path, uint64_t size, bool create)
+{
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		create ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	if (size == 0)
+	{
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			unmap();
+			return false;
+		}
+		size = (uint64_t)fileSize.QuadPart;
+	}
+	// Grows the file to size.
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+	if (mapping == nullptr)
+	{
+		unmap();
+		return false;
+	}
+	header = static_cast<Header*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size));
+#else
+	file = open(path, create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+	if (file < 0)
+	{
+		return false;
+	}
+	if (size == 0)
+	{
+		struct stat st;
+		if (fstat(file, &st) != 0 || st.st_size == 0)
+		{
+			unmap();
+			return false;
+		}
+		size = (uint64_t)st.st_size;
+	}
+	else if (ftruncate(file, (off_t)size) != 0)
+	{
+		unmap();
+		return false;
+	}
+	void* address = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	header = address != MAP_FAILED ? static_cast<Header*>(address) : nullptr;
+#endif
+	if (header == nullptr)
+	{
+		unmap();
+		return false;
+	}
+	mappedSize = (size_t)size;
+	return true;
+}
+
+void EventJournal::unmap(void)
+{
+#ifdef _WIN32
+	if (header != nullptr)
+	{
+		UnmapViewOfFile(header);
+	}
+	if (mapping != nullptr)
+	{
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (header != nullptr)
+	{
+		munmap(header, mappedSize);
+	}
+	if (file >= 0)
+	{
+		close(file);
+		file = -1;
+	}
+#endif
+	header = nullptr;
+	slots = nullptr;
+	mappedSize = 0;
+}
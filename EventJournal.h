@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// -----------------------------
+// Append-only journal of the events Events queues, a memory-mapped file
+// of fixed-size records. Append() copies the record into the mapping:
+// producers reserve their slot with an atomic counter, no lock and no
+// system call. A record counts once its commit word, written last, matches
+// its sequence number. Open() of an existing journal scans for them and
+// appends after the last one, so a crash only loses the records being
+// written. When the file is full, records are dropped and counted.
+// -----------------------------
+class EventJournal
+{
+public:
+	struct Record
+	{
+		// Position in the journal, from 0.
+		uint64_t sequence;
+		// Wall clock, nanoseconds since 1970.
+		int64_t timeNs;
+		int32_t type;
+		// MyEvent fields.
+		int32_t code;
+		int32_t priority;
+		int32_t coalesceKey;
+		int32_t orderingKey;
+		int32_t reserved;
+	};
+
+	EventJournal();
+	~EventJournal();
+
+	// Maps path, creating it with room for capacity records; an existing
+	// journal keeps its size and its records. Not thread safe, open the
+	// journal before the threads that append start.
+	bool Open(const char* path, uint64_t capacity);
+	// Writes the mapping back to the file and unmaps it.
+	void Close(void);
+	bool IsOpen(void) const { return slots != nullptr; }
+
+	// Any thread. time is when the event was queued; the sequence number
+	// is assigned here. False when the journal is full.
+	bool Append(Record record, std::chrono::steady_clock::time_point time);
+	// Records reserved so far, committed or not.
+	uint64_t Count(void) const;
+	uint64_t Capacity(void) const { return capacity; }
+	// False for a record that was never committed.
+	bool Read(uint64_t sequence, Record& record) const;
+	uint64_t Dropped(void) const { return dropped.load(std::memory_order_relaxed); }
+	// Uncommitted records Open() found before the last committed one.
+	uint64_t RecoveredHoles(void) const { return holes; }
+
+private:
+	struct Header;
+	struct Slot
+	{
+		Record record;
+		// sequence + 1 once record is complete.
+		std::atomic<uint64_t> commit;
+	};
+
+	bool map(const char* path, uint64_t size, bool create);
+	void unmap(void);
+
+	Header* header;
+	Slot* slots;
+	uint64_t capacity;
+	uint64_t holes;
+	std::atomic<uint64_t> next;
+	std::atomic<uint64_t> dropped;
+	// Converts the steady enqueue times to wall clock.
+	std::chrono::steady_clock::time_point steadyBase;
+	int64_t wallBaseNs;
+	size_t mappedSize;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+};
@@ -0,0 +1,192 @@
+#include "EventLatency.h"
+#include "imgui.h"
+
+static const char* codeNames[] =
+{
+	"NONE",
+	"NEW",
+	"OPEN",
+	"SAVE",
+	"SET_ORIGIN",
+	"RUN",
+	"STOP",
+	"PAUSE",
+	"GOTO",
+	"CONNECT",
+	"DISCONNECT",
+	"EXIT",
+	"JUMP_TO_CURSOR",
+	"MANUAL",
+	"DATA_POLL"
+};
+
+static int histogramIndex(int code)
+{
+	if (code < 0 || code >= EventLatency::MAX_CODES)
+	{
+		return EventLatency::MAX_CODES - 1;
+	}
+	return code;
+}
+
+EventLatency::EventLatency(const char* title, const char* heading)
+	: title(title), heading(heading)
+{
+	Reset();
+}
+
+const char* EventLatency::CodeName(int code)
+{
+	if (code < 0 || code >= (int)(sizeof(codeNames) / sizeof(codeNames[0])))
+	{
+		return "other";
+	}
+	return codeNames[code];
+}
+
+void EventLatency::Record(int code, std::chrono::steady_clock::duration latency)
+{
+	Histogram& h = histograms[histogramIndex(code)];
+	int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+	uint64_t value = us > 0 ? (uint64_t)us : 0;
+	int bucket = 0;
+	while (bucket < BUCKETS - 1 && value >= ((uint64_t)1 << bucket))
+	{
+		++bucket;
+	}
+	h.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	h.count.fetch_add(1, std::memory_order_relaxed);
+	uint64_t maxUs = h.maxUs.load(std::memory_order_relaxed);
+	while (value > maxUs && !h.maxUs.compare_exchange_weak(maxUs, value, std::memory_order_relaxed))
+	{
+	}
+}
+
+void EventLatency::RecordMerged(int code, int count)
+{
+	histograms[histogramIndex(code)].merged.fetch_add((uint64_t)count, std::memory_order_relaxed);
+}
+
+void EventLatency::Reset(void)
+{
+	for (int i = 0; i < MAX_CODES; ++i)
+	{
+		for (int b = 0; b < BUCKETS; ++b)
+		{
+			histograms[i].buckets[b].store(0, std::memory_order_relaxed);
+		}
+		histograms[i].count.store(0, std::memory_order_relaxed);
+		histograms[i].maxUs.store(0, std::memory_order_relaxed);
+		histograms[i].merged.store(0, std::memory_order_relaxed);
+	}
+}
+
+uint64_t EventLatency::Count(int code) const
+{
+	return histograms[histogramIndex(code)].count.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLatency::PercentileUs(int code, float p) const
+{
+	const Histogram& h = histograms[histogramIndex(code)];
+	uint32_t counts[BUCKETS];
+	uint64_t total = 0;
+	for (int b = 0; b < BUCKETS; ++b)
+	{
+		counts[b] = h.buckets[b].load(std::memory_order_relaxed);
+		total += counts[b];
+	}
+	if (total == 0)
+	{
+		return 0;
+	}
+	// Nearest rank, as in FrameStats.
+	uint64_t rank = (uint64_t)(p * total + 0.999999f);
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+	uint64_t maxUs = MaxUs(code);
+	uint64_t seen = 0;
+	for (int b = 0; b < BUCKETS - 1; ++b)
+	{
+		seen += counts[b];
+		if (seen >= rank)
+		{
+			uint64_t bound = (uint64_t)1 << b;
+			return bound < maxUs ? bound : maxUs;
+		}
+	}
+	return maxUs;
+}
+
+uint64_t EventLatency::MaxUs(int code) const
+{
+	return histograms[histogramIndex(code)].maxUs.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLatency::Merged(int code) const
+{
+	return histograms[histogramIndex(code)].merged.load(std::memory_order_relaxed);
+}
+
+void EventLatency::PrintSummary(FILE* f) const
+{
+	fprintf(f, "%s, us (bucket upper bounds)\n", heading);
+	fprintf(f, "%-16s %9s %9s %9s %9s %9s %9s\n", "event", "count", "p50", "p95", "p99", "max", "merged");
+	for (int code = 0; code < MAX_CODES; ++code)
+	{
+		if (Count(code) == 0)
+		{
+			continue;
+		}
+		fprintf(f, "%-16s %9llu %9llu %9llu %9llu %9llu %9llu\n", CodeName(code), (unsigned long long)Count(code),
+			(unsigned long long)PercentileUs(code, 0.50f), (unsigned long long)PercentileUs(code, 0.95f),
+			(unsigned long long)PercentileUs(code, 0.99f), (unsigned long long)MaxUs(code),
+			(unsigned long long)Merged(code));
+	}
+}
+// -----------------------------
+//
+// -----------------------------
+void EventLatency::ShowPanel(bool* p_open)
+{
+	if (!ImGui::Begin(title, p_open))
+	{
+		ImGui::End();
+		return;
+	}
+	ImGui::Text("%s, us (bucket upper bounds)", heading);
+	if (ImGui::BeginTable("latency", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Event");
+		ImGui::TableSetupColumn("count");
+		ImGui::TableSetupColumn("p50");
+		ImGui::TableSetupColumn("p95");
+		ImGui::TableSetupColumn("p99");
+		ImGui::TableSetupColumn("max");
+		ImGui::TableSetupColumn("merged");
+		ImGui::TableHeadersRow();
+		for (int code = 0; code < MAX_CODES; ++code)
+		{
+			if (Count(code) == 0)
+			{
+				continue;
+			}
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", CodeName(code));
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)Count(code));
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)PercentileUs(code, 0.50f));
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)PercentileUs(code, 0.95f));
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)PercentileUs(code, 0.99f));
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)MaxUs(code));
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)Merged(code));
+		}
+		ImGui::EndTable();
+	}
+	if (ImGui::Button("Reset"))
+	{
+		Reset();
+	}
+	ImGui::End();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// -----------------------------
+// Latency histograms of the events loop, one log2 histogram per event code
+// (MyEvent::e, the GUI command): enqueue-to-dispatch latency, and timer
+// lateness. Written by the events threads; the GUI thread reads the
+// counters without locking, so a histogram read while an event is recorded
+// may miss that event.
+// -----------------------------
+class EventLatency
+{
+public:
+	// Codes outside [0, MAX_CODES) share the last histogram.
+	static const int MAX_CODES = 16;
+	// Bucket b counts latencies below 2^b microseconds, the last one the rest.
+	static const int BUCKETS = 32;
+
+	// title: panel window title; heading: what is measured, for the panel
+	// and the summary.
+	EventLatency(const char* title, const char* heading);
+
+	static const char* CodeName(int code);
+
+	void Record(int code, std::chrono::steady_clock::duration latency);
+	// count pending events were replaced by the dispatched one.
+	void RecordMerged(int code, int count);
+	void Reset(void);
+
+	uint64_t Count(int code) const;
+	// Upper bound of the bucket holding the p-th percentile (at most the
+	// maximum), microseconds.
+	uint64_t PercentileUs(int code, float p) const;
+	uint64_t MaxUs(int code) const;
+	uint64_t Merged(int code) const;
+
+	// Codes with at least one event, used by the headless benchmark run.
+	void PrintSummary(FILE* f) const;
+	// Dockable panel with the same table.
+	void ShowPanel(bool* p_open);
+
+private:
+	struct Histogram
+	{
+		std::atomic<uint32_t> buckets[BUCKETS];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> maxUs;
+		std::atomic<uint64_t> merged;
+	};
+	Histogram histograms[MAX_CODES];
+	const char* title;
+	const char* heading;
+};
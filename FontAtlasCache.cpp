@@ -0,0 +1,415 @@
+#include "FontAtlasCache.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "spdlog/spdlog.h"
+
+static const uint32_t CACHE_MAGIC = 0x41464D49; // "IMFA"
+static const uint32_t CACHE_VERSION = 1;
+
+// -----------------------------
+// FNV-1a, enough to detect changed inputs.
+// -----------------------------
+static void hashBytes(uint64_t& h, const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		h ^= p[i];
+		h *= 0x100000001B3ULL;
+	}
+}
+
+template <typename T>
+static void hashValue(uint64_t& h, const T& value)
+{
+	hashBytes(h, &value, sizeof(T));
+}
+
+// -----------------------------
+// Read-only memory mapping of the cache file.
+// -----------------------------
+class MappedFile
+{
+public:
+	MappedFile() : data(nullptr), size(0)
+	{
+#ifdef _WIN32
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#else
+		fd = -1;
+#endif
+	}
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (data != nullptr) UnmapViewOfFile(data);
+		if (mapping != NULL) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (data != nullptr) munmap((void*)data, size);
+		if (fd >= 0) close(fd);
+#endif
+	}
+
+	bool Open(const char* fileName)
+	{
+#ifdef _WIN32
+		file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			return false;
+		}
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		size = (size_t)fileSize.QuadPart;
+#else
+		fd = open(fileName, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			return false;
+		}
+		void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED)
+		{
+			return false;
+		}
+		data = (const unsigned char*)p;
+		size = (size_t)st.st_size;
+#endif
+		return data != nullptr;
+	}
+
+	const unsigned char* data;
+	size_t size;
+
+private:
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+// -----------------------------
+// Bounds-checked cursor over the mapped file.
+// -----------------------------
+class CacheReader
+{
+public:
+	CacheReader(const unsigned char* data, size_t size) : p(data), end(data + size), ok(true)
+	{
+	}
+
+	template <typename T>
+	T Read()
+	{
+		T value = T();
+		ReadBytes(&value, sizeof(T));
+		return value;
+	}
+
+	void ReadBytes(void* dst, size_t count)
+	{
+		if (!ok || (size_t)(end - p) < count)
+		{
+			ok = false;
+			return;
+		}
+		memcpy(dst, p, count);
+		p += count;
+	}
+
+	const unsigned char* p;
+	const unsigned char* end;
+	bool ok;
+};
+
+template <typename T>
+static void writeValue(FILE* f, const T& value)
+{
+	fwrite(&value, sizeof(T), 1, f);
+}
+
+static int fontIndex(const ImFontAtlas* atlas, const ImFont* font)
+{
+	for (int i = 0; i < atlas->Fonts.Size; ++i)
+	{
+		if (atlas->Fonts[i] == font)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+// -----------------------------
+//
+// -----------------------------
+uint64_t FontAtlasCache::ComputeKey(ImFontAtlas* atlas)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+	hashBytes(h, IMGUI_VERSION, sizeof(IMGUI_VERSION));
+	hashValue(h, sizeof(ImFontGlyph));
+	hashValue(h, sizeof(ImWchar));
+#ifdef IMGUI_ENABLE_FREETYPE
+	hashValue(h, 1);
+#endif
+	hashValue(h, atlas->Flags);
+	hashValue(h, atlas->TexDesiredWidth);
+	hashValue(h, atlas->TexGlyphPadding);
+	hashValue(h, atlas->FontBuilderFlags);
+	hashValue(h, atlas->Fonts.Size);
+	for (int i = 0; i < atlas->ConfigData.Size; ++i)
+	{
+		const ImFontConfig& cfg = atlas->ConfigData[i];
+		hashBytes(h, cfg.FontData, (size_t)cfg.FontDataSize);
+		hashValue(h, cfg.FontNo);
+		hashValue(h, cfg.SizePixels);
+		hashValue(h, cfg.OversampleH);
+		hashValue(h, cfg.OversampleV);
+		hashValue(h, cfg.PixelSnapH);
+		hashValue(h, cfg.GlyphExtraSpacing);
+		hashValue(h, cfg.GlyphOffset);
+		hashValue(h, cfg.GlyphMinAdvanceX);
+		hashValue(h, cfg.GlyphMaxAdvanceX);
+		hashValue(h, cfg.MergeMode);
+		hashValue(h, cfg.FontBuilderFlags);
+		hashValue(h, cfg.RasterizerMultiply);
+		hashValue(h, cfg.EllipsisChar);
+		hashValue(h, fontIndex(atlas, cfg.DstFont));
+		const ImWchar* ranges = cfg.GlyphRanges ? cfg.GlyphRanges : atlas->GetGlyphRangesDefault();
+		for (; ranges[0]; ranges += 2)
+		{
+			hashValue(h, ranges[0]);
+			hashValue(h, ranges[1]);
+		}
+	}
+	return h;
+}
+// -----------------------------
+//
+// -----------------------------
+bool FontAtlasCache::Save(const ImFontAtlas* atlas, const char* fileName, uint64_t key)
+{
+	if (atlas->TexPixelsAlpha8 == nullptr)
+	{
+		// Colored (RGBA) atlases are not cached.
+		return false;
+	}
+	FILE* f = fopen(fileName, "wb");
+	if (f == nullptr)
+	{
+		return false;
+	}
+	writeValue(f, CACHE_MAGIC);
+	writeValue(f, CACHE_VERSION);
+	writeValue(f, key);
+	writeValue(f, atlas->TexWidth);
+	writeValue(f, atlas->TexHeight);
+	writeValue(f, atlas->TexUvScale);
+	writeValue(f, atlas->TexUvWhitePixel);
+	fwrite(atlas->TexUvLines, sizeof(atlas->TexUvLines), 1, f);
+	writeValue(f, atlas->PackIdMouseCursors);
+	writeValue(f, atlas->PackIdLines);
+
+	writeValue(f, atlas->CustomRects.Size);
+	for (int i = 0; i < atlas->CustomRects.Size; ++i)
+	{
+		ImFontAtlasCustomRect r = atlas->CustomRects[i];
+		int font = fontIndex(atlas, r.Font);
+		r.Font = nullptr;
+		writeValue(f, r);
+		writeValue(f, font);
+	}
+
+	writeValue(f, atlas->Fonts.Size);
+	for (int i = 0; i < atlas->Fonts.Size; ++i)
+	{
+		const ImFont* font = atlas->Fonts[i];
+		writeValue(f, font->FontSize);
+		writeValue(f, font->Ascent);
+		writeValue(f, font->Descent);
+		writeValue(f, font->MetricsTotalSurface);
+		writeValue(f, font->ConfigDataCount);
+		writeValue(f, font->FallbackChar);
+		writeValue(f, font->EllipsisChar);
+		writeValue(f, font->DotChar);
+		writeValue(f, font->Glyphs.Size);
+		fwrite(font->Glyphs.Data, sizeof(ImFontGlyph), (size_t)font->Glyphs.Size, f);
+	}
+
+	fwrite(atlas->TexPixelsAlpha8, 1, (size_t)atlas->TexWidth * atlas->TexHeight, f);
+	bool ok = ferror(f) == 0;
+	fclose(f);
+	if (!ok)
+	{
+		remove(fileName);
+	}
+	return ok;
+}
+// -----------------------------
+//
+// -----------------------------
+bool FontAtlasCache::Load(ImFontAtlas* atlas, const char* fileName, uint64_t key)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+	{
+		return false;
+	}
+	CacheReader in(file.data, file.size);
+	if (in.Read<uint32_t>() != CACHE_MAGIC || in.Read<uint32_t>() != CACHE_VERSION || in.Read<uint64_t>() != key)
+	{
+		return false;
+	}
+
+	int texWidth = in.Read<int>();
+	int texHeight = in.Read<int>();
+	ImVec2 uvScale = in.Read<ImVec2>();
+	ImVec2 uvWhitePixel = in.Read<ImVec2>();
+	ImVec4 uvLines[IM_ARRAYSIZE(atlas->TexUvLines)];
+	in.ReadBytes(uvLines, sizeof(uvLines));
+	int packIdMouseCursors = in.Read<int>();
+	int packIdLines = in.Read<int>();
+
+	int rectCount = in.Read<int>();
+	if (!in.ok || rectCount < 0 || texWidth <= 0 || texHeight <= 0)
+	{
+		return false;
+	}
+	ImVector<ImFontAtlasCustomRect> rects;
+	rects.resize(rectCount);
+	for (int i = 0; i < rectCount && in.ok; ++i)
+	{
+		rects[i] = in.Read<ImFontAtlasCustomRect>();
+		int font = in.Read<int>();
+		rects[i].Font = (font >= 0 && font < atlas->Fonts.Size) ? atlas->Fonts[font] : nullptr;
+	}
+
+	// The key already covers the font list, a mismatch means a corrupted file.
+	if (in.Read<int>() != atlas->Fonts.Size)
+	{
+		return false;
+	}
+	// Parse everything before touching the atlas, so a truncated file leaves it intact.
+	struct FontData
+	{
+		float fontSize, ascent, descent;
+		int metricsTotalSurface;
+		short configDataCount;
+		ImWchar fallbackChar, ellipsisChar, dotChar;
+		ImVector<ImFontGlyph> glyphs;
+	};
+	std::vector<FontData> fonts(atlas->Fonts.Size);
+	for (int i = 0; i < atlas->Fonts.Size && in.ok; ++i)
+	{
+		FontData& fd = fonts[i];
+		fd.fontSize = in.Read<float>();
+		fd.ascent = in.Read<float>();
+		fd.descent = in.Read<float>();
+		fd.metricsTotalSurface = in.Read<int>();
+		fd.configDataCount = in.Read<short>();
+		fd.fallbackChar = in.Read<ImWchar>();
+		fd.ellipsisChar = in.Read<ImWchar>();
+		fd.dotChar = in.Read<ImWchar>();
+		int glyphCount = in.Read<int>();
+		if (glyphCount <= 0 || (size_t)(in.end - in.p) < glyphCount * sizeof(ImFontGlyph))
+		{
+			return false;
+		}
+		fd.glyphs.resize(glyphCount);
+		in.ReadBytes(fd.glyphs.Data, glyphCount * sizeof(ImFontGlyph));
+	}
+	size_t pixelsSize = (size_t)texWidth * texHeight;
+	if (!in.ok || (size_t)(in.end - in.p) != pixelsSize)
+	{
+		return false;
+	}
+
+	// Same state ImFontAtlasBuildFinish() leaves behind, without rasterizing.
+	atlas->ClearTexData();
+	atlas->TexWidth = texWidth;
+	atlas->TexHeight = texHeight;
+	atlas->TexUvScale = uvScale;
+	atlas->TexUvWhitePixel = uvWhitePixel;
+	memcpy(atlas->TexUvLines, uvLines, sizeof(uvLines));
+	atlas->PackIdMouseCursors = packIdMouseCursors;
+	atlas->PackIdLines = packIdLines;
+	atlas->CustomRects.swap(rects);
+	atlas->TexPixelsAlpha8 = (unsigned char*)IM_ALLOC(pixelsSize);
+	memcpy(atlas->TexPixelsAlpha8, in.p, pixelsSize);
+
+	for (int i = 0; i < atlas->Fonts.Size; ++i)
+	{
+		ImFont* font = atlas->Fonts[i];
+		FontData& fd = fonts[i];
+		font->ClearOutputData();
+		font->FontSize = fd.fontSize;
+		font->Ascent = fd.ascent;
+		font->Descent = fd.descent;
+		font->MetricsTotalSurface = fd.metricsTotalSurface;
+		font->ConfigDataCount = fd.configDataCount;
+		font->FallbackChar = fd.fallbackChar;
+		font->EllipsisChar = fd.ellipsisChar;
+		font->DotChar = fd.dotChar;
+		font->Glyphs.swap(fd.glyphs);
+		font->ContainerAtlas = atlas;
+		for (int n = 0; n < atlas->ConfigData.Size; ++n)
+		{
+			if (atlas->ConfigData[n].DstFont == font && !atlas->ConfigData[n].MergeMode)
+			{
+				font->ConfigData = &atlas->ConfigData[n];
+				break;
+			}
+		}
+		font->BuildLookupTable();
+	}
+	atlas->TexReady = true;
+	return true;
+}
+// -----------------------------
+//
+// -----------------------------
+bool FontAtlasCache::LoadOrBuild(ImFontAtlas* atlas, const char* fileName)
+{
+	uint64_t key = ComputeKey(atlas);
+	if (Load(atlas, fileName, key))
+	{
+		spdlog::info((const char*)u8"Font atlas loaded from cache {0}.", fileName);
+		return true;
+	}
+	atlas->Build();
+	if (!Save(atlas, fileName, key))
+	{
+		spdlog::warn((const char*)u8"Can't write font atlas cache {0}.", fileName);
+	}
+	return false;
+}
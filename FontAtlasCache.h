@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include "imgui.h"
+
+// -----------------------------
+// On-disk cache of a built ImFontAtlas (alpha8 texture, glyph tables and
+// custom rects). The key covers the font file contents, sizes, glyph ranges,
+// every ImFontConfig setting and the atlas build options, so any change in
+// InitGraphics invalidates the cache. Call after the AddFont*() calls and
+// before the backend builds the font texture.
+// -----------------------------
+class FontAtlasCache
+{
+public:
+	// Restores the atlas from fileName or builds it and writes the cache.
+	// Returns true when the atlas came from the cache.
+	static bool LoadOrBuild(ImFontAtlas* atlas, const char* fileName);
+
+	static uint64_t ComputeKey(ImFontAtlas* atlas);
+	static bool Load(ImFontAtlas* atlas, const char* fileName, uint64_t key);
+	static bool Save(const ImFontAtlas* atlas, const char* fileName, uint64_t key);
+};
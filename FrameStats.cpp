@@ -0,0 +1,336 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include "imgui.h"
+
+static const char* phaseNames[FRAME_PHASE_COUNT] =
+{
+	"PollEvents",
+	"NewFrame",
+	"ProgramUI",
+	"FileDialogs",
+	"Inspector",
+	"ImGui::Render",
+	"RenderDrawData",
+	"SwapBuffers"
+};
+
+static const char* counterNames[FRAME_COUNTER_COUNT] =
+{
+	"upload_bytes",
+	"buffer_allocs",
+	"map_stalls",
+	"draw_cmds",
+	"draw_calls"
+};
+
+// Nearest-rank percentile, sorts values in place.
+static float percentile(std::vector<float>& values, float p)
+{
+	if (values.empty())
+	{
+		return 0;
+	}
+	size_t rank = (size_t)std::ceil(p * values.size());
+	size_t ind = rank > 0 ? rank - 1 : 0;
+	std::nth_element(values.begin(), values.begin() + ind, values.end());
+	return values[ind];
+}
+
+static float elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+	return std::chrono::duration<float, std::milli>(to - from).count();
+}
+
+// Statistic rows: every phase, then the whole render() and the frame interval.
+static const int STAT_ROWS = FRAME_PHASE_COUNT + 2;
+
+static const char* rowName(int row)
+{
+	if (row < FRAME_PHASE_COUNT)
+	{
+		return phaseNames[row];
+	}
+	return row == FRAME_PHASE_COUNT ? "render()" : "interval";
+}
+
+static void rowValues(const std::vector<FrameSample>& samples, int row, std::vector<float>& values)
+{
+	values.resize(samples.size());
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		if (row < FRAME_PHASE_COUNT)
+		{
+			values[i] = samples[i].phaseMs[row];
+		}
+		else if (row == FRAME_PHASE_COUNT)
+		{
+			values[i] = samples[i].cpuMs;
+		}
+		else
+		{
+			values[i] = samples[i].frameMs;
+		}
+	}
+}
+static void counterValues(const std::vector<FrameSample>& samples, int counter, std::vector<float>& values, double* total)
+{
+	values.resize(samples.size());
+	*total = 0;
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		values[i] = (float)samples[i].counters[counter];
+		*total += samples[i].counters[counter];
+	}
+}
+// -----------------------------
+//
+// -----------------------------
+FrameStats::FrameStats()
+{
+	written = 0;
+	current = FrameSample();
+	hasPrevFrame = false;
+	frameStart = std::chrono::steady_clock::now();
+	phaseStart = frameStart;
+}
+
+const char* FrameStats::PhaseName(int phase)
+{
+	if (phase < 0 || phase >= FRAME_PHASE_COUNT)
+	{
+		return "";
+	}
+	return phaseNames[phase];
+}
+
+const char* FrameStats::CounterName(int counter)
+{
+	if (counter < 0 || counter >= FRAME_COUNTER_COUNT)
+	{
+		return "";
+	}
+	return counterNames[counter];
+}
+// -----------------------------
+//
+// -----------------------------
+void FrameStats::BeginFrame(void)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	current = FrameSample();
+	current.frameMs = hasPrevFrame ? elapsedMs(frameStart, now) : 0;
+	hasPrevFrame = true;
+	frameStart = now;
+	phaseStart = now;
+}
+
+void FrameStats::Mark(int phase)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	current.phaseMs[phase] += elapsedMs(phaseStart, now);
+	phaseStart = now;
+}
+
+void FrameStats::Add(int phase, float ms)
+{
+	current.phaseMs[phase] += ms;
+}
+
+void FrameStats::SetCounter(int counter, uint32_t value)
+{
+	current.counters[counter] = value;
+}
+
+void FrameStats::EndFrame(void)
+{
+	current.cpuMs = 0;
+	for (int i = 0; i < FRAME_PHASE_COUNT; ++i)
+	{
+		current.cpuMs += current.phaseMs[i];
+	}
+	size_t n = written.load(std::memory_order_relaxed);
+	ring[n % HISTORY_SIZE] = current;
+	written.store(n + 1, std::memory_order_release);
+}
+// -----------------------------
+//
+// -----------------------------
+size_t FrameStats::Snapshot(std::vector<FrameSample>& out) const
+{
+	out.clear();
+	size_t end = written.load(std::memory_order_acquire);
+	size_t begin = end > HISTORY_SIZE ? end - HISTORY_SIZE : 0;
+	for (size_t i = begin; i < end; ++i)
+	{
+		out.push_back(ring[i % HISTORY_SIZE]);
+	}
+	// The writer may have lapped us while copying: drop slots it reused.
+	size_t after = written.load(std::memory_order_acquire);
+	size_t firstValid = after > HISTORY_SIZE ? after - HISTORY_SIZE : 0;
+	if (firstValid > begin)
+	{
+		size_t stale = std::min(firstValid - begin, out.size());
+		out.erase(out.begin(), out.begin() + stale);
+	}
+	return out.size();
+}
+
+bool FrameStats::SaveCSV(const std::string& fileName) const
+{
+	std::vector<FrameSample> samples;
+	Snapshot(samples);
+	FILE* f = fopen(fileName.c_str(), "w");
+	if (f == nullptr)
+	{
+		return false;
+	}
+	fprintf(f, "frame");
+	for (int i = 0; i < FRAME_PHASE_COUNT; ++i)
+	{
+		fprintf(f, ",%s", phaseNames[i]);
+	}
+	fprintf(f, ",cpu_ms,frame_ms");
+	for (int i = 0; i < FRAME_COUNTER_COUNT; ++i)
+	{
+		fprintf(f, ",%s", counterNames[i]);
+	}
+	fprintf(f, "\n");
+	for (size_t n = 0; n < samples.size(); ++n)
+	{
+		fprintf(f, "%zu", n);
+		for (int i = 0; i < FRAME_PHASE_COUNT; ++i)
+		{
+			fprintf(f, ",%.4f", samples[n].phaseMs[i]);
+		}
+		fprintf(f, ",%.4f,%.4f", samples[n].cpuMs, samples[n].frameMs);
+		for (int i = 0; i < FRAME_COUNTER_COUNT; ++i)
+		{
+			fprintf(f, ",%u", (unsigned)samples[n].counters[i]);
+		}
+		fprintf(f, "\n");
+	}
+	fclose(f);
+	return true;
+}
+
+void FrameStats::PrintSummary(FILE* f) const
+{
+	std::vector<FrameSample> samples;
+	std::vector<float> values;
+	Snapshot(samples);
+	fprintf(f, "Frame timing over last %d frames, ms\n", (int)samples.size());
+	fprintf(f, "%-16s %9s %9s %9s %9s\n", "phase", "p50", "p95", "p99", "max");
+	if (samples.empty())
+	{
+		return;
+	}
+	for (int row = 0; row < STAT_ROWS; ++row)
+	{
+		rowValues(samples, row, values);
+		float maxValue = *std::max_element(values.begin(), values.end());
+		float p50 = percentile(values, 0.50f);
+		float p95 = percentile(values, 0.95f);
+		float p99 = percentile(values, 0.99f);
+		fprintf(f, "%-16s %9.3f %9.3f %9.3f %9.3f\n", rowName(row), p50, p95, p99, maxValue);
+	}
+	fprintf(f, "Renderer counters per frame\n");
+	fprintf(f, "%-16s %9s %9s %9s %12s\n", "counter", "p50", "p95", "max", "total");
+	for (int counter = 0; counter < FRAME_COUNTER_COUNT; ++counter)
+	{
+		double total;
+		counterValues(samples, counter, values, &total);
+		float maxValue = *std::max_element(values.begin(), values.end());
+		float p50 = percentile(values, 0.50f);
+		float p95 = percentile(values, 0.95f);
+		fprintf(f, "%-16s %9.0f %9.0f %9.0f %12.0f\n", counterNames[counter], p50, p95, maxValue, total);
+	}
+}
+// -----------------------------
+//
+// -----------------------------
+void FrameStats::ShowPanel(bool* p_open)
+{
+	if (!ImGui::Begin((const char*)u8" ", p_open))
+	{
+		ImGui::End();
+		return;
+	}
+	Snapshot(panelSamples);
+	if (panelSamples.empty())
+	{
+		ImGui::Text("No frames yet.");
+		ImGui::End();
+		return;
+	}
+
+	panelValues.resize(panelSamples.size());
+	for (size_t i = 0; i < panelSamples.size(); ++i)
+	{
+		panelValues[i] = panelSamples[i].cpuMs;
+	}
+	const FrameSample& last = panelSamples.back();
+	char overlay[64];
+	snprintf(overlay, sizeof(overlay), "cpu %.2f ms", last.cpuMs);
+	ImGui::PlotLines("##cpu_ms", panelValues.data(), (int)panelValues.size(), 0, overlay, 0.0f, FLT_MAX, ImVec2(-1, 80));
+	ImGui::Text("Frames: %d  interval: %.2f ms", (int)panelSamples.size(), last.frameMs);
+
+	if (ImGui::BeginTable("phases", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Phase");
+		ImGui::TableSetupColumn("p50");
+		ImGui::TableSetupColumn("p95");
+		ImGui::TableSetupColumn("p99");
+		ImGui::TableSetupColumn("max");
+		ImGui::TableHeadersRow();
+		for (int row = 0; row < STAT_ROWS; ++row)
+		{
+			rowValues(panelSamples, row, panelValues);
+			float maxValue = *std::max_element(panelValues.begin(), panelValues.end());
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", rowName(row));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(panelValues, 0.50f));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(panelValues, 0.95f));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(panelValues, 0.99f));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", maxValue);
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::BeginTable("counters", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Counter");
+		ImGui::TableSetupColumn("p50");
+		ImGui::TableSetupColumn("p95");
+		ImGui::TableSetupColumn("max");
+		ImGui::TableSetupColumn("total");
+		ImGui::TableHeadersRow();
+		for (int counter = 0; counter < FRAME_COUNTER_COUNT; ++counter)
+		{
+			double total;
+			counterValues(panelSamples, counter, panelValues, &total);
+			float maxValue = *std::max_element(panelValues.begin(), panelValues.end());
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", counterNames[counter]);
+			ImGui::TableNextColumn(); ImGui::Text("%.0f", percentile(panelValues, 0.50f));
+			ImGui::TableNextColumn(); ImGui::Text("%.0f", percentile(panelValues, 0.95f));
+			ImGui::TableNextColumn(); ImGui::Text("%.0f", maxValue);
+			ImGui::TableNextColumn(); ImGui::Text("%.0f", total);
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::Button("CSV"))
+	{
+		const char* fileName = "frame_timing.csv";
+		csvResult = SaveCSV(fileName) ? std::string("Saved ") + fileName : std::string("Can't write ") + fileName;
+	}
+	if (!csvResult.empty())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%s", csvResult.c_str());
+	}
+	ImGui::End();
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// -----------------------------
+// Phases of MainGUIWindow::render() timed separately.
+// With pipelined rendering RenderDrawData is the render thread's GL
+// submission of the previous frame and SwapBuffers is the time the GUI
+// thread spent copying draw data and waiting for a free buffer.
+// -----------------------------
+enum FramePhase
+{
+	FRAME_PHASE_POLL_EVENTS = 0,
+	FRAME_PHASE_NEW_FRAME,
+	FRAME_PHASE_PROGRAM_UI,
+	FRAME_PHASE_FILE_DIALOGS,
+	FRAME_PHASE_INSPECTOR,
+	FRAME_PHASE_IMGUI_RENDER,
+	FRAME_PHASE_RENDER_DRAW_DATA,
+	FRAME_PHASE_SWAP_BUFFERS,
+	FRAME_PHASE_COUNT
+};
+
+// -----------------------------
+// Renderer counters recorded per frame next to the phase timings.
+// -----------------------------
+enum FrameCounter
+{
+	FRAME_COUNTER_UPLOAD_BYTES = 0,
+	FRAME_COUNTER_BUFFER_ALLOCS,
+	FRAME_COUNTER_MAP_STALLS,
+	// Visible draw commands, and the GL draw calls issued for them (fewer
+	// than the commands with the draw optimizer).
+	FRAME_COUNTER_DRAW_CMDS,
+	FRAME_COUNTER_DRAW_CALLS,
+	FRAME_COUNTER_COUNT
+};
+
+struct FrameSample
+{
+	float phaseMs[FRAME_PHASE_COUNT];
+	uint32_t counters[FRAME_COUNTER_COUNT];
+	// Sum of the phases, i.e. time spent inside render().
+	float cpuMs;
+	// Interval since the previous frame started (includes idle waits).
+	float frameMs;
+};
+
+// -----------------------------
+// Per-phase frame timer with a fixed-size history ring.
+// Written by the GUI thread only; Snapshot() may be called from any
+// thread without locking, samples overwritten during the copy are dropped.
+// -----------------------------
+class FrameStats
+{
+public:
+	static const size_t HISTORY_SIZE = 1024;
+
+	FrameStats();
+
+	static const char* PhaseName(int phase);
+	static const char* CounterName(int counter);
+
+	void BeginFrame(void);
+	// Closes the phase that started at the previous Mark() or BeginFrame().
+	void Mark(int phase);
+	// Adds a duration measured elsewhere (e.g. by the render thread).
+	void Add(int phase, float ms);
+	void SetCounter(int counter, uint32_t value);
+	void EndFrame(void);
+
+	// Copies the most recent samples, oldest first.
+	size_t Snapshot(std::vector<FrameSample>& out) const;
+	bool SaveCSV(const std::string& fileName) const;
+	// p50/p95/p99/max tables, used by the headless benchmark run.
+	void PrintSummary(FILE* f) const;
+	// Dockable panel with percentiles and the frame time graph.
+	void ShowPanel(bool* p_open);
+
+private:
+	std::array<FrameSample, HISTORY_SIZE> ring;
+	std::atomic<size_t> written;
+	FrameSample current;
+	std::chrono::steady_clock::time_point frameStart;
+	std::chrono::steady_clock::time_point phaseStart;
+	bool hasPrevFrame;
+
+	// Panel scratch buffers, reused between frames.
+	std::vector<FrameSample> panelSamples;
+	std::vector<float> panelValues;
+	std::string csvResult;
+};
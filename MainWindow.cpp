@@ -1,11 +1,34 @@
 #include "MainWindow.h"
 #include "FileBrowser/ImGuiFileBrowser.h"
 #include "ImGuiPropertyInspector.h"
+#include "FontAtlasCache.h"
+#include "imgui_freetype.h"
 static imgui_addons::ImGuiFileBrowser file_dialog;
 static bool show_open_dialog = false;
 static bool show_save_dialog = false;
 static property::inspector props_briwser("browser");
 // -----------------------------
+// Idle rendering input hooks. Installed before the ImGui GLFW backend,
+// which chains to them, so they only have to flag the UI as dirty.
+// -----------------------------
+static void markWindowDirty(GLFWwindow* window)
+{
+	MainGUIWindow* gui = static_cast<MainGUIWindow*>(glfwGetWindowUserPointer(window));
+	if (gui != nullptr)
+	{
+		gui->RequestRedraw();
+	}
+}
+static void idleMouseButtonCallback(GLFWwindow* window, int, int, int) { markWindowDirty(window); }
+static void idleScrollCallback(GLFWwindow* window, double, double) { markWindowDirty(window); }
+static void idleKeyCallback(GLFWwindow* window, int, int, int, int) { markWindowDirty(window); }
+static void idleCharCallback(GLFWwindow* window, unsigned int) { markWindowDirty(window); }
+static void idleFocusCallback(GLFWwindow* window, int) { markWindowDirty(window); }
+static void idleCursorEnterCallback(GLFWwindow* window, int) { markWindowDirty(window); }
+static void idleCursorPosCallback(GLFWwindow* window, double, double) { markWindowDirty(window); }
+static void idleFramebufferSizeCallback(GLFWwindow* window, int, int) { markWindowDirty(window); }
+static void idleRefreshCallback(GLFWwindow* window) { markWindowDirty(window); }
+// -----------------------------
 // Main window 
 // -----------------------------
 MainGUIWindow::MainGUIWindow(Events& events):events_(events)
@@ -16,13 +39,35 @@ MainGUIWindow::MainGUIWindow(Events& events):events_(events)
 	// Size of window
 	win_width = constants::WINDOW_WIDTH;
 	win_height = constants::WINDOW_HEIGHT;
-	prev_time = std::chrono::steady_clock::now();
 	statusMessage = "Message";
+	deviceState = -1;
+	showFrameStats = false;
+	showEventLatency = false;
+	showTimerLateness = false;
+	showEventShards = false;
+	showQueueBounds = false;
 
 	toolbarSize = 50;
 	statusbarSize = 50;
 	menuBarHeight = 0;
 	resized = false;
+
+	idleRendering = true;
+	headless = false;
+	maxFrames = 0;
+	pipelinedRendering = false;
+	renderThread = nullptr;
+	dynamicFonts = false;
+	fontAtlas = nullptr;
+	sdfFonts = false;
+	streamMode = ImGui_ImplOpenGL3_StreamMode_BufferData;
+	drawOptimizer = false;
+	lastRenderStats = ImGui_ImplOpenGL3_RenderStats();
+	uiDirty = true;
+	catchUpFrames = constants::IDLE_CATCHUP_FRAMES;
+	GUILoopThread = nullptr;
+	// Events threads wake the GUI when they post an update.
+	events_.SetGuiWakeup([this]() { RequestRedraw(); });
 	
 			props_briwser.clear();
             props_briwser.AppendEntity();
@@ -35,6 +80,7 @@ MainGUIWindow::MainGUIWindow(Events& events):events_(events)
 MainGUIWindow::~MainGUIWindow()
 {
 	spdlog::info((const char*)u8"MainGUIWindow destructor.");
+	events_.SetGuiWakeup(nullptr);
 
 }
 // -----------------------------
@@ -240,6 +286,15 @@ int MainGUIWindow::ToolbarUI()
 			if (ImGui::MenuItem((const char*)u8"", "", false)) { command = constants::GUI_COMMAND_EXIT; }
 			ImGui::EndMenu();
 		}
+		if (ImGui::BeginMenu((const char*)u8""))
+		{
+			ImGui::MenuItem((const char*)u8" ", "", &showFrameStats);
+			ImGui::MenuItem((const char*)u8" ", "", &showEventLatency);
+			ImGui::MenuItem((const char*)u8" ", "", &showTimerLateness);
+			ImGui::MenuItem((const char*)u8" ", "", &showEventShards);
+			ImGui::MenuItem((const char*)u8" ", "", &showQueueBounds);
+			ImGui::EndMenu();
+		}
 		ImGui::EndMenuBar();
 	}
 
@@ -250,7 +305,7 @@ int MainGUIWindow::ToolbarUI()
 	return command;
 }
 
-void MainGUIWindow::StatusbarUI(std::string statusMessage)
+void MainGUIWindow::StatusbarUI(const std::string& statusMessage)
 {
 	ImGuiViewport* viewport = ImGui::GetMainViewport();
 	ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x, viewport->Pos.y + viewport->Size.y - statusbarSize));
@@ -274,6 +329,18 @@ void MainGUIWindow::StatusbarUI(std::string statusMessage)
 	char buf[1000] = { 0 };
 	sprintf(buf, (const char*)u8" ");
 	ImGui::Text(buf);
+	ImGui::SameLine();
+	ImGui::Text("%s", statusText.c_str());
+	if (deviceState >= 0)
+	{
+		ImGui::SameLine();
+		ImGui::Text("%s", deviceState != 0 ? (const char*)u8"|  " : (const char*)u8"|  ");
+	}
+	if (!errorText.empty())
+	{
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "| %s", errorText.c_str());
+	}
 
 	ImGui::End();
 	ImGui::PopStyleColor();
@@ -281,7 +348,7 @@ void MainGUIWindow::StatusbarUI(std::string statusMessage)
 // -----------------------------
 // Organize our dockspace
 // -----------------------------
-int MainGUIWindow::ProgramUI(std::string statusMessage)
+int MainGUIWindow::ProgramUI(const std::string& statusMessage)
 {
 	DockSpaceUI();
 	int command = ToolbarUI();
@@ -293,14 +360,43 @@ int MainGUIWindow::ProgramUI(std::string statusMessage)
 // -----------------------------
 int MainGUIWindow::render()
 {
+	frameStats.BeginFrame();
+	ApplyGuiUpdates();
 	ImGui::GetIO().WantCaptureMouse = true;
 	glfwPollEvents();
+	frameStats.Mark(FRAME_PHASE_POLL_EVENTS);
+	if (fontAtlas != nullptr)
+	{
+		// Rasterize the glyphs the previous frame could not find.
+		fontAtlas->Update();
+	}
 	// Start the Dear ImGui frame
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
+	frameStats.Mark(FRAME_PHASE_NEW_FRAME);
 	// Render our dock (menu, toolbar, status bar).    
 	int command = ProgramUI(statusMessage);
+	if (showFrameStats)
+	{
+		frameStats.ShowPanel(&showFrameStats);
+	}
+	if (showEventLatency)
+	{
+		events_.latency.ShowPanel(&showEventLatency);
+	}
+	if (showTimerLateness)
+	{
+		events_.timerLateness.ShowPanel(&showTimerLateness);
+	}
+	if (showEventShards)
+	{
+		ShowEventShards(&showEventShards);
+	}
+	if (showQueueBounds)
+	{
+		ShowQueueBounds(&showQueueBounds);
+	}
 	if (command == constants::GUI_COMMAND_NEW)
 	{
 		ImGui::OpenPopup((const char*)u8" ");
@@ -343,6 +439,7 @@ int MainGUIWindow::render()
 	{
 		ImGui::OpenPopup((const char*)u8" ");
 	}
+	frameStats.Mark(FRAME_PHASE_PROGRAM_UI);
 
 	//Show an open/save/select file dialog. Last argument provides a list of supported files. Selecting other files will show error. If "*.*" is provided, all files can be opened.
 	if (file_dialog.showFileDialog((const char*)u8" ", imgui_addons::ImGuiFileBrowser::DialogMode::OPEN, ImVec2(900, 600), ".tbl"))
@@ -358,12 +455,9 @@ int MainGUIWindow::render()
 		printf("%s\n", file_dialog.selected_path.c_str());
 		
 	}
-
-
+	frameStats.Mark(FRAME_PHASE_FILE_DIALOGS);
 
 	// Rendering user content
-	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-
 	/*
 			static bool open_popup = true;
 			static std::string m_file_path;
@@ -413,23 +507,145 @@ int MainGUIWindow::render()
 	std::stringstream statusMessageTime;
 	statusMessageTime << std::ctime(&result);
 	statusMessage = statusMessageTime.str();
+	frameStats.Mark(FRAME_PHASE_INSPECTOR);
 
-	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-	// std::cout << "Elapseed = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << "[s]" << std::endl;
-	// std::cout << "Elapseed (frame)= " << std::chrono::duration_cast<std::chrono::microseconds>(end - prev_time).count() << "[s]" << std::endl;
-	prev_time = end;
-
+	if (renderThread != nullptr)
+	{
+		// Pipelined: the render thread owns the context and draws a copy.
+		ImGui::Render();
+		if (fontAtlas != nullptr && fontAtlas->HasRequests())
+		{
+			RequestRedraw();
+		}
+		frameStats.Mark(FRAME_PHASE_IMGUI_RENDER);
+		frameStats.Add(FRAME_PHASE_RENDER_DRAW_DATA, renderThread->lastRenderMs);
+		ImGui_ImplOpenGL3_RenderStats stats = ImGui_ImplOpenGL3_RenderStats();
+		stats.BytesUploaded = renderThread->uploadedBytes;
+		stats.BufferAllocs = renderThread->bufferAllocs;
+		stats.MapStalls = renderThread->mapStalls;
+		stats.DrawCmds = renderThread->drawCmds;
+		stats.DrawCalls = renderThread->drawCalls;
+		RecordRenderCounters(stats);
+		renderThread->Submit(ImGui::GetDrawData());
+		frameStats.Mark(FRAME_PHASE_SWAP_BUFFERS);
+		frameStats.EndFrame();
+		return command;
+	}
 
 	// ImGui rendering
 	glClearColor(0, 0, 0, 1.0);
 	glClear(GL_COLOR_BUFFER_BIT);
 	// Rendering
 	ImGui::Render();
+	if (fontAtlas != nullptr)
+	{
+		if (fontAtlas->HasRequests())
+		{
+			// Draw again once the missing glyphs are in the atlas.
+			RequestRedraw();
+		}
+		fontAtlas->UploadDirty();
+	}
+	frameStats.Mark(FRAME_PHASE_IMGUI_RENDER);
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	frameStats.Mark(FRAME_PHASE_RENDER_DRAW_DATA);
+	ImGui_ImplOpenGL3_RenderStats stats;
+	ImGui_ImplOpenGL3_GetRenderStats(&stats);
+	RecordRenderCounters(stats);
 	glfwSwapBuffers(window);
+	frameStats.Mark(FRAME_PHASE_SWAP_BUFFERS);
+	frameStats.EndFrame();
 	return command;
 }
 
+void MainGUIWindow::RecordRenderCounters(const ImGui_ImplOpenGL3_RenderStats& stats)
+{
+	frameStats.SetCounter(FRAME_COUNTER_UPLOAD_BYTES, (uint32_t)(stats.BytesUploaded - lastRenderStats.BytesUploaded));
+	frameStats.SetCounter(FRAME_COUNTER_BUFFER_ALLOCS, stats.BufferAllocs - lastRenderStats.BufferAllocs);
+	frameStats.SetCounter(FRAME_COUNTER_MAP_STALLS, stats.MapStalls - lastRenderStats.MapStalls);
+	frameStats.SetCounter(FRAME_COUNTER_DRAW_CMDS, (uint32_t)(stats.DrawCmds - lastRenderStats.DrawCmds));
+	frameStats.SetCounter(FRAME_COUNTER_DRAW_CALLS, (uint32_t)(stats.DrawCalls - lastRenderStats.DrawCalls));
+	lastRenderStats = stats;
+}
+
+void MainGUIWindow::ShowEventShards(bool* p_open)
+{
+	if (!ImGui::Begin((const char*)u8" ", p_open))
+	{
+		ImGui::End();
+		return;
+	}
+	if (events_.ShardCount() == 0)
+	{
+		ImGui::Text("Dispatched by the events loop, start with --event-workers N for workers.");
+	}
+	else if (ImGui::BeginTable("shards", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Worker");
+		ImGui::TableSetupColumn("depth");
+		ImGui::TableSetupColumn("max depth");
+		ImGui::TableSetupColumn("dispatched");
+		ImGui::TableSetupColumn("p50, us");
+		ImGui::TableSetupColumn("p99, us");
+		ImGui::TableSetupColumn("max, us");
+		ImGui::TableHeadersRow();
+		for (int i = 0; i < events_.ShardCount(); ++i)
+		{
+			Events::ShardStats stats = events_.GetShardStats(i);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%d", i);
+			ImGui::TableNextColumn(); ImGui::Text("%d", stats.depth);
+			ImGui::TableNextColumn(); ImGui::Text("%d", stats.maxDepth);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats.dispatched);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats.p50Us);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats.p99Us);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats.maxUs);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
+void MainGUIWindow::ShowQueueBounds(bool* p_open)
+{
+	if (!ImGui::Begin((const char*)u8" ", p_open))
+	{
+		ImGui::End();
+		return;
+	}
+	if (ImGui::BeginTable("bounds", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Type");
+		ImGui::TableSetupColumn("capacity");
+		ImGui::TableSetupColumn("overflow");
+		ImGui::TableSetupColumn("pending");
+		ImGui::TableSetupColumn("high water");
+		ImGui::TableSetupColumn("dropped");
+		ImGui::TableSetupColumn("blocked");
+		ImGui::TableSetupColumn("coalesced");
+		ImGui::TableHeadersRow();
+		for (int type = 0; type < constants::MAX_EVENT_TYPES; ++type)
+		{
+			Events::QueueBoundStats stats = events_.GetQueueBoundStats(type);
+			if (stats.capacity == 0)
+			{
+				continue;
+			}
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%d", type);
+			ImGui::TableNextColumn(); ImGui::Text("%d", stats.capacity);
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(Events::OverflowName(stats.overflow));
+			ImGui::TableNextColumn(); ImGui::Text("%d", stats.pending);
+			ImGui::TableNextColumn(); ImGui::Text("%d", stats.highWater);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats.dropped);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats.blocked);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats.coalesced);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
 void MainGUIWindow::resize_window_callback(GLFWwindow* glfw_window, int x, int y)
 {
 	if (x == 0 || y == 0)
@@ -458,41 +674,78 @@ void MainGUIWindow::InitGraphics()
 	const char* glsl_version = "#version 130";
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	if (headless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+	}
 	// Create window with graphics context
 	window = glfwCreateWindow(win_width, win_height, (const char*)u8"", NULL, NULL);
+	if (window == NULL && headless)
+	{
+		// GLFW built without OSMesa: use a hidden window with a native context.
+		spdlog::warn((const char*)u8"OSMesa context is not available, using a hidden native window.");
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+		window = glfwCreateWindow(win_width, win_height, (const char*)u8"", NULL, NULL);
+	}
 	if (window == NULL)
 	{
 		return;
 	}
 	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1); // Enable vsync
+	glfwSwapInterval(headless ? 0 : 1); // Enable vsync
+	glfwSetWindowUserPointer(window, this);
+	InstallIdleCallbacks();
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO(); (void)io;
 	io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+	if (headless)
+	{
+		// Benchmark runs must not depend on (or change) the saved layout.
+		io.IniFilename = NULL;
+	}
 
-	// Load Fonts        
-	io.Fonts->AddFontFromFileTTF("fonts/FiraCode/ttf/FiraCode-Regular.ttf", 30, NULL, io.Fonts->GetGlyphRangesCyrillic());
-	// merge in icons from Font Awesome
-	static  ImWchar icons_ranges[] = { ICON_MIN_FA, ICON_MAX_FA, 0 };
-	ImFontConfig icons_config; icons_config.MergeMode = true; icons_config.PixelSnapH = true;
-	io.Fonts->AddFontFromFileTTF("fonts/fontawesome-webfont.ttf", 30.0f, &icons_config, icons_ranges);
-	// Load Fonts        
-	io.Fonts->AddFontFromFileTTF("fonts/a_FuturaOrto.TTF", 20, NULL, io.Fonts->GetGlyphRangesCyrillic());
+	AddFonts(io.Fonts, sdfFonts);
+	if (dynamicFonts)
+	{
+		// Basic Latin up front, everything else on first use. The content
+		// depends on the session, so the disk cache is not used.
+		static const ImWchar preload_ranges[] = { 0x0020, 0x007E, 0 };
+		fontAtlas = new DynamicFontAtlas();
+		if (!fontAtlas->Build(io.Fonts, constants::FONT_ATLAS_DYNAMIC_SIZE, preload_ranges))
+		{
+			delete fontAtlas;
+			fontAtlas = nullptr;
+		}
+	}
+	if (fontAtlas == nullptr)
+	{
+		// Skip FreeType rasterization when the fonts did not change since the last run.
+		FontAtlasCache::LoadOrBuild(io.Fonts, "fonts/font_atlas.cache");
+	}
 
 
 	// Setup Platform/Renderer bindings
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
 	ImGui_ImplOpenGL3_Init(glsl_version);
+	ImGui_ImplOpenGL3_SetFontTextureSdf(sdfFonts);
+	ImGui_ImplOpenGL3_SetStreamMode(streamMode);
+	ImGui_ImplOpenGL3_SetDrawOptimizer(drawOptimizer);
 	// Initialize GLEW
 	glewExperimental = true; // Needed for core profile
 
 	if (glewInit() != GLEW_OK)
 	{
 		fprintf(stderr, "Failed to initialize GLEW\n");
-		return;
+		// Software contexts may not expose the GLEW entry points; render()
+		// itself only needs GL 1.1 calls and the backend's own loader.
+		if (!headless)
+		{
+			return;
+		}
 	}
 
 	//glfwSetWindowSizeCallback(window, resize_window_callback);
@@ -511,12 +764,202 @@ void MainGUIWindow::InitGraphics()
 }
 
 
+// -----------------------------
+// Fonts
+// -----------------------------
+void MainGUIWindow::AddFonts(ImFontAtlas* atlas, bool sdf)
+{
+	if (sdf)
+	{
+		// Distance fields are thresholded by the shader, baked
+		// antialiased lines would lose their edges: draw them as geometry.
+		atlas->FontBuilderFlags |= ImGuiFreeTypeBuilderFlags_SDF;
+		atlas->Flags |= ImFontAtlasFlags_NoBakedLines;
+	}
+	// Displayed sizes. In the SDF mode every face is rasterized at the
+	// base size and ImFont::Scale brings it to the displayed one.
+	const float codeSize = 30.0f;
+	const float uiSize = 20.0f;
+	// Load Fonts        
+	ImFont* codeFont = atlas->AddFontFromFileTTF("fonts/FiraCode/ttf/FiraCode-Regular.ttf", sdf ? constants::FONT_SDF_BASE_SIZE : codeSize, NULL, atlas->GetGlyphRangesCyrillic());
+	// merge in icons from Font Awesome
+	static  ImWchar icons_ranges[] = { ICON_MIN_FA, ICON_MAX_FA, 0 };
+	ImFontConfig icons_config; icons_config.MergeMode = true; icons_config.PixelSnapH = true;
+	atlas->AddFontFromFileTTF("fonts/fontawesome-webfont.ttf", sdf ? constants::FONT_SDF_BASE_SIZE : codeSize, &icons_config, icons_ranges);
+	// Load Fonts        
+	ImFont* uiFont = atlas->AddFontFromFileTTF("fonts/a_FuturaOrto.TTF", sdf ? constants::FONT_SDF_BASE_SIZE : uiSize, NULL, atlas->GetGlyphRangesCyrillic());
+	if (sdf && codeFont != NULL && uiFont != NULL)
+	{
+		codeFont->Scale = codeSize / constants::FONT_SDF_BASE_SIZE;
+		uiFont->Scale = uiSize / constants::FONT_SDF_BASE_SIZE;
+	}
+}
+
+void MainGUIWindow::BenchmarkFontBuild(FILE* f)
+{
+	const int RUNS = 5;
+	const int threads = (int)std::thread::hardware_concurrency();
+	double bestMs[2] = { 1e9, 1e9 };
+	std::vector<unsigned char> serialPixels;
+	bool identical = true;
+	int glyphs = 0;
+	int texWidth = 0;
+	int texHeight = 0;
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		// mode 0: calling thread only, mode 1: one worker per hardware thread.
+		ImGuiFreeType::SetBuilderThreadCount(mode == 0 ? 1 : 0);
+		for (int run = 0; run < RUNS; ++run)
+		{
+			ImFontAtlas atlas;
+			AddFonts(&atlas);
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			atlas.Build();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			if (ms < bestMs[mode])
+			{
+				bestMs[mode] = ms;
+			}
+			size_t size = (size_t)atlas.TexWidth * atlas.TexHeight;
+			if (mode == 0 && run == 0)
+			{
+				serialPixels.assign(atlas.TexPixelsAlpha8, atlas.TexPixelsAlpha8 + size);
+				texWidth = atlas.TexWidth;
+				texHeight = atlas.TexHeight;
+				glyphs = 0;
+				for (int i = 0; i < atlas.Fonts.Size; ++i)
+				{
+					glyphs += atlas.Fonts[i]->Glyphs.Size;
+				}
+			}
+			else if (size != serialPixels.size() || memcmp(atlas.TexPixelsAlpha8, serialPixels.data(), size) != 0)
+			{
+				identical = false;
+			}
+		}
+	}
+	ImGuiFreeType::SetBuilderThreadCount(0);
+	fprintf(f, "Font atlas build, %d glyphs, %dx%d, best of %d runs:\n", glyphs, texWidth, texHeight, RUNS);
+	fprintf(f, "  1 thread    %8.2f ms\n", bestMs[0]);
+	fprintf(f, "  %-2d threads  %8.2f ms\n", threads, bestMs[1]);
+	fprintf(f, "  speedup     %8.2fx, texture %s\n", bestMs[0] / bestMs[1], identical ? "identical" : "DIFFERS");
+}
+
+// -----------------------------
+// Idle rendering
+// -----------------------------
+void MainGUIWindow::InstallIdleCallbacks(void)
+{
+	glfwSetMouseButtonCallback(window, idleMouseButtonCallback);
+	glfwSetScrollCallback(window, idleScrollCallback);
+	glfwSetKeyCallback(window, idleKeyCallback);
+	glfwSetCharCallback(window, idleCharCallback);
+	glfwSetWindowFocusCallback(window, idleFocusCallback);
+	glfwSetCursorEnterCallback(window, idleCursorEnterCallback);
+	glfwSetCursorPosCallback(window, idleCursorPosCallback);
+	glfwSetFramebufferSizeCallback(window, idleFramebufferSizeCallback);
+	glfwSetWindowRefreshCallback(window, idleRefreshCallback);
+}
+
+void MainGUIWindow::ApplyGuiUpdates(void)
+{
+	GuiUpdate updates[constants::GUI_UPDATES_PER_FRAME];
+	int count = events_.TakeGuiUpdates(updates, constants::GUI_UPDATES_PER_FRAME);
+	for (int i = 0; i < count; ++i)
+	{
+		const GuiUpdate& update = updates[i];
+		switch (update.kind)
+		{
+		case constants::GUI_UPDATE_STATUS:
+			statusText = update.text;
+			errorText.clear();
+			break;
+		case constants::GUI_UPDATE_DEVICE:
+			deviceState = update.code;
+			break;
+		case constants::GUI_UPDATE_FILE_LOADED:
+			statusText = std::string((const char*)u8" ") + update.text;
+			errorText.clear();
+			break;
+		case constants::GUI_UPDATE_ERROR:
+			errorText = update.text;
+			break;
+		default:
+			break;
+		}
+	}
+	if (count == constants::GUI_UPDATES_PER_FRAME)
+	{
+		// The rest on the next frame.
+		uiDirty = true;
+	}
+}
+
+void MainGUIWindow::RequestRedraw(void)
+{
+	uiDirty = true;
+	if (initialized)
+	{
+		// Wakes glfwWaitEventsTimeout when called from another thread.
+		glfwPostEmptyEvent();
+	}
+}
+
+bool MainGUIWindow::IsAnimating(void)
+{
+	ImGuiIO& io = ImGui::GetIO();
+	// Modals fade in and the file dialogs refresh their listing, the text
+	// cursor blinks, held buttons drive drags and scrolling. Results of
+	// queued commands come back as GUI updates, which wake the loop.
+	return ImGui::IsPopupOpen("", ImGuiPopupFlags_AnyPopupId | ImGuiPopupFlags_AnyPopupLevel)
+		|| io.WantTextInput
+		|| ImGui::IsAnyMouseDown();
+}
+
+void MainGUIWindow::WaitForUIEvents(void)
+{
+	if (IsAnimating())
+	{
+		catchUpFrames = constants::IDLE_CATCHUP_FRAMES;
+		return;
+	}
+	if (uiDirty.exchange(false))
+	{
+		catchUpFrames = constants::IDLE_CATCHUP_FRAMES;
+		return;
+	}
+	if (catchUpFrames > 0)
+	{
+		--catchUpFrames;
+		return;
+	}
+	// Nothing to draw: sleep until input, RequestRedraw() or the status clock tick.
+	glfwWaitEventsTimeout(constants::IDLE_WAIT_TIMEOUT_MS / 1000.0);
+	if (uiDirty.exchange(false))
+	{
+		catchUpFrames = constants::IDLE_CATCHUP_FRAMES;
+	}
+}
+
 // -----------------------------
 // Free graphic resources
 // -----------------------------
 void MainGUIWindow::TerminateGraphics(void)
 {
+	// No more RequestRedraw() from the events threads: once this returns
+	// none is running, so none can call GLFW during or after glfwTerminate().
+	events_.SetGuiWakeup(nullptr);
 	initialized = false;
+	if (renderThread != nullptr)
+	{
+		renderThread->Stop();
+		delete renderThread;
+		renderThread = nullptr;
+		// Take the context back to free the GL objects.
+		glfwMakeContextCurrent(window);
+	}
+	delete fontAtlas;
+	fontAtlas = nullptr;
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -530,17 +973,61 @@ void MainGUIWindow::TerminateGraphics(void)
 void MainGUIWindow::GUILoop(void)
 {
 	InitGraphics();
+	if (window == nullptr)
+	{
+		spdlog::error((const char*)u8"Failed to create the GLFW window.");
+		glfwTerminate();
+		isGUILoopRunning = false;
+		return;
+	}
+	if (pipelinedRendering)
+	{
+		// NewFrame creates the GL objects lazily; do it while the context is ours.
+		ImGui_ImplOpenGL3_CreateDeviceObjects();
+		glfwMakeContextCurrent(NULL);
+		renderThread = new RenderThread(window);
+		renderThread->fontAtlas = fontAtlas;
+		renderThread->Start();
+	}
 	isGUILoopRunning = true;
 	spdlog::info((const char*)u8"  GUILoop.");
+	int frames = 0;
 	while (!needStop && !glfwWindowShouldClose(window))
 	{
+		if (maxFrames > 0 && frames++ >= maxFrames)
+		{
+			break;
+		}
+		if (idleRendering && !headless)
+		{
+			WaitForUIEvents();
+			if (needStop || glfwWindowShouldClose(window))
+			{
+				break;
+			}
+		}
 		int command = render();
 		if (command != constants::GUI_COMMAND_NONE)
 		{
 			spdlog::info((const char*)u8"Worker: enqueue commandEvent({0}).", command);
-			events_.queue.enqueue(constants::EVENT_TYPE_GUI, std::shared_ptr < MyEvent>(new MyEvent(command, 1)));
+			MyEvent event(command, 1);
+			event.coalesceKey = Events::CoalesceKey(command);
+			event.orderingKey = Events::OrderingKey(command);
+			events_.Enqueue(constants::EVENT_TYPE_GUI, event);
+		}
+		if (!idleRendering && !headless)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
 		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	if (headless)
+	{
+		frameStats.PrintSummary(stdout);
+		events_.latency.PrintSummary(stdout);
+		events_.timerLateness.PrintSummary(stdout);
+		events_.PrintShardSummary(stdout);
+		events_.PrintQueueBoundSummary(stdout);
+		fprintf(stdout, "GUI updates dropped: %llu\n", (unsigned long long)events_.GuiUpdatesDropped());
 	}
 	spdlog::info((const char*)u8"  .");
 	isGUILoopRunning = false;
@@ -562,6 +1049,8 @@ void MainGUIWindow::Run(void)
 void MainGUIWindow::Stop(void)
 {
 	needStop = true;
+	// The GUI thread may be sleeping in glfwWaitEventsTimeout.
+	RequestRedraw();
 	if (GUILoopThread != nullptr)
 	{
 		if (GUILoopThread->joinable())
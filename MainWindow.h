@@ -3,6 +3,7 @@
 #include <iostream>
 #include <chrono>
 #include <sstream>
+#include <atomic>
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
@@ -13,9 +14,22 @@
 #include <GL/glew.h>            // Initialize with glewInit()
 //Include glfw3.h after our OpenGL definitions
 #include <GLFW/glfw3.h>
+// Context creation APIs of GLFW 3.3+, missing from the bundled 3.2 header.
+#ifndef GLFW_CONTEXT_CREATION_API
+#define GLFW_CONTEXT_CREATION_API   0x0002200B
+#endif
+#ifndef GLFW_NATIVE_CONTEXT_API
+#define GLFW_NATIVE_CONTEXT_API     0x00036001
+#endif
+#ifndef GLFW_OSMESA_CONTEXT_API
+#define GLFW_OSMESA_CONTEXT_API     0x00036003
+#endif
 #include "icons_font_awesome_4.h"
 #include "events.h"
 #include "ImGuiPropertyInspector.h"
+#include "FrameStats.h"
+#include "RenderThread.h"
+#include "DynamicFontAtlas.h"
 class MainGUIWindow
 {
 public:
@@ -24,23 +38,51 @@ public:
     GLFWwindow* window;
     int win_width;
     int win_height;
-    std::chrono::steady_clock::time_point prev_time;
+    // Status bar clock, GUI thread only like the fields below.
     std::string statusMessage;
-    bool initialized;
+    // Read by RequestRedraw() on other threads.
+    std::atomic<bool> initialized;
     bool resized;
 
     float toolbarSize;
     float statusbarSize;
     float menuBarHeight;    
 
+    // Per-phase timing of render() and its panel.
+    FrameStats frameStats;
+    bool showFrameStats;
+    // Panel of events_.latency.
+    bool showEventLatency;
+    // Panel of events_.timerLateness.
+    bool showTimerLateness;
+    // Queue depth and latency of the event dispatch workers.
+    bool showEventShards;
+    void ShowEventShards(bool* p_open);
+    // Capacity, high-water mark and overflow counters of the queue bounds.
+    bool showQueueBounds;
+    void ShowQueueBounds(bool* p_open);
+
+    // -----------------------------
+    // Updates from events_
+    // -----------------------------
+    // Called at the top of render(): applies up to GUI_UPDATES_PER_FRAME
+    // updates, more pending ones draw another frame.
+    void ApplyGuiUpdates(void);
+    // Shown in the status bar.
+    std::string statusText;
+    // Last error, until the next status.
+    std::string errorText;
+    // -1 until the first GUI_UPDATE_DEVICE.
+    int deviceState;
+
     void ShowAppDockSpace(bool* p_open);
     void DockSpaceUI();
     int ToolbarUI();
-    void StatusbarUI(std::string statusMessage);
+    void StatusbarUI(const std::string& statusMessage);
     // -----------------------------
     // Organize our dockspace
     // -----------------------------
-    int ProgramUI(std::string statusMessage);
+    int ProgramUI(const std::string& statusMessage);
     // -----------------------------
     // 
     // -----------------------------
@@ -50,11 +92,64 @@ public:
     // Initializing openGL things
     // -----------------------------
     void InitGraphics();
+    // Production fonts, shared by InitGraphics and the build benchmark.
+    // sdf: rasterize distance fields once at FONT_SDF_BASE_SIZE.
+    static void AddFonts(ImFontAtlas* atlas, bool sdf = false);
+    // Times the FreeType atlas build on one thread and on all of them.
+    static void BenchmarkFontBuild(FILE* f);
     // -----------------------------
     // Free graphic resources
     // -----------------------------
     void TerminateGraphics(void);
 
+    // -----------------------------
+    // Idle rendering
+    // -----------------------------
+    // Draw only when something changed instead of at vsync rate.
+    bool idleRendering;
+    // Thread safe: marks the UI dirty and wakes the GUI thread.
+    void RequestRedraw(void);
+    // True while ImGui needs continuous frames (popups, text input, drags).
+    bool IsAnimating(void);
+    // Blocks in glfwWaitEventsTimeout until the next frame is needed.
+    void WaitForUIEvents(void);
+
+    // -----------------------------
+    // Headless benchmark run
+    // -----------------------------
+    // Hidden window with an OSMesa context (native one as a fallback),
+    // no vsync and no idle waits; stops after maxFrames and prints timings.
+    bool headless;
+    int maxFrames;
+
+    // -----------------------------
+    // Pipelined rendering
+    // -----------------------------
+    // GL submission and vsync wait run on renderThread while the GUI
+    // thread builds the next frame.
+    bool pipelinedRendering;
+    RenderThread* renderThread;
+
+    // -----------------------------
+    // Vertex upload
+    // -----------------------------
+    // ImGui_ImplOpenGL3_StreamMode_, BufferData unless --stream-buffers.
+    int streamMode;
+    // Merge compatible draw commands before submission (--merge-draws).
+    bool drawOptimizer;
+    // Per-frame deltas of the backend upload and draw totals go to frameStats.
+    void RecordRenderCounters(const ImGui_ImplOpenGL3_RenderStats& stats);
+    ImGui_ImplOpenGL3_RenderStats lastRenderStats;
+
+    // -----------------------------
+    // Dynamic font atlas
+    // -----------------------------
+    // Glyphs are rasterized on first use instead of whole ranges at startup.
+    bool dynamicFonts;
+    DynamicFontAtlas* fontAtlas;
+    // Signed distance field fonts: one atlas entry per glyph for any size.
+    bool sdfFonts;
+
     void Run(void);
     void Stop(void);
     bool isGUILoopRunning;
@@ -62,6 +157,11 @@ public:
     void GUILoop(void);
     std::thread* GUILoopThread;
 
+private:
+    std::atomic<bool> uiDirty;
+    int catchUpFrames;
+    void InstallIdleCallbacks(void);
+
 public:
     Events& events_;    
 };
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "RenderThread.h"
+#include <chrono>
+#include <cstring>
+#include "imgui_impl_opengl3.h"
+#include "spdlog/spdlog.h"
+
+template <typename T>
+static void copyVector(ImVector<T>& dst, const ImVector<T>& src)
+{
+	// ImVector::resize keeps the capacity, no allocation once it is large enough.
+	dst.resize(src.Size);
+	if (src.Size > 0)
+	{
+		memcpy(dst.Data, src.Data, (size_t)src.size_in_bytes());
+	}
+}
+// -----------------------------
+//
+// -----------------------------
+DrawDataCopy::DrawDataCopy()
+{
+}
+
+DrawDataCopy::~DrawDataCopy()
+{
+	for (int i = 0; i < lists.Size; ++i)
+	{
+		IM_DELETE(lists[i]);
+	}
+}
+
+void DrawDataCopy::CopyFrom(const ImDrawData* src)
+{
+	while (lists.Size < src->CmdListsCount)
+	{
+		lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+	}
+	cmdLists.resize(src->CmdListsCount);
+	for (int i = 0; i < src->CmdListsCount; ++i)
+	{
+		const ImDrawList* from = src->CmdLists[i];
+		ImDrawList* to = lists[i];
+		copyVector(to->CmdBuffer, from->CmdBuffer);
+		copyVector(to->IdxBuffer, from->IdxBuffer);
+		copyVector(to->VtxBuffer, from->VtxBuffer);
+		to->Flags = from->Flags;
+		cmdLists[i] = to;
+	}
+	drawData = *src;
+	drawData.CmdLists = cmdLists.Data;
+}
+// -----------------------------
+//
+// -----------------------------
+RenderThread::RenderThread(GLFWwindow* window)
+{
+	this->window = window;
+	busy[0] = false;
+	busy[1] = false;
+	writeIndex = 0;
+	pending = -1;
+	needStop = false;
+	thread = nullptr;
+	lastRenderMs = 0;
+	uploadedBytes = 0;
+	bufferAllocs = 0;
+	mapStalls = 0;
+	drawCmds = 0;
+	drawCalls = 0;
+	fontAtlas = nullptr;
+}
+
+RenderThread::~RenderThread()
+{
+	Stop();
+}
+
+void RenderThread::Start(void)
+{
+	spdlog::info((const char*)u8"Render thread starting.");
+	needStop = false;
+	thread = new std::thread(&RenderThread::renderLoop, this);
+}
+
+void RenderThread::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		needStop = true;
+	}
+	cv.notify_all();
+	if (thread != nullptr)
+	{
+		if (thread->joinable())
+		{
+			thread->join();
+		}
+		delete thread;
+		thread = nullptr;
+	}
+}
+
+void RenderThread::Submit(const ImDrawData* drawData)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	int index = writeIndex;
+	cv.wait(lock, [this, index] { return !busy[index] || needStop; });
+	if (needStop)
+	{
+		return;
+	}
+	// A free buffer is touched by nobody else, copy without holding the lock.
+	lock.unlock();
+	buffers[index].CopyFrom(drawData);
+	lock.lock();
+	if (pending >= 0)
+	{
+		// The render thread has not picked up the previous frame yet: drop it.
+		busy[pending] = false;
+	}
+	busy[index] = true;
+	pending = index;
+	writeIndex = 1 - index;
+	lock.unlock();
+	cv.notify_all();
+}
+
+void RenderThread::renderLoop(void)
+{
+	glfwMakeContextCurrent(window);
+	while (true)
+	{
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return pending >= 0 || needStop; });
+			if (needStop)
+			{
+				break;
+			}
+			index = pending;
+			pending = -1;
+		}
+
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		if (fontAtlas != nullptr)
+		{
+			fontAtlas->UploadDirty();
+		}
+		glClearColor(0, 0, 0, 1.0);
+		glClear(GL_COLOR_BUFFER_BIT);
+		ImGui_ImplOpenGL3_RenderDrawData(buffers[index].Get());
+		lastRenderMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		ImGui_ImplOpenGL3_RenderStats stats;
+		ImGui_ImplOpenGL3_GetRenderStats(&stats);
+		uploadedBytes = stats.BytesUploaded;
+		bufferAllocs = stats.BufferAllocs;
+		mapStalls = stats.MapStalls;
+		drawCmds = stats.DrawCmds;
+		drawCalls = stats.DrawCalls;
+		glfwSwapBuffers(window);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy[index] = false;
+		}
+		cv.notify_all();
+	}
+	glfwMakeContextCurrent(NULL);
+	spdlog::info((const char*)u8"Render thread stopped.");
+}
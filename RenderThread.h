@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "imgui.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "DynamicFontAtlas.h"
+
+// -----------------------------
+// Deep copy of ImDrawData. Draw lists and their buffers are pooled and
+// reused between frames, so once the pool has grown to the size of the UI
+// copying a frame does not allocate.
+// -----------------------------
+class DrawDataCopy
+{
+public:
+	DrawDataCopy();
+	~DrawDataCopy();
+
+	void CopyFrom(const ImDrawData* src);
+	ImDrawData* Get(void) { return &drawData; }
+
+private:
+	ImDrawData drawData;
+	// Pool of copies, grows only.
+	ImVector<ImDrawList*> lists;
+	// Pointer array handed out through drawData.CmdLists.
+	ImVector<ImDrawList*> cmdLists;
+};
+
+// -----------------------------
+// GL submission thread for the pipelined mode: the GUI thread builds
+// frame N+1 while this thread draws frame N and blocks on vsync.
+// The GL context is owned by this thread between Start() and Stop().
+// -----------------------------
+class RenderThread
+{
+public:
+	RenderThread(GLFWwindow* window);
+	~RenderThread();
+
+	// The caller must release the context (glfwMakeContextCurrent(NULL)) before.
+	void Start(void);
+	// Joins the thread and releases the context, the caller may take it back.
+	void Stop(void);
+	// Copies draw data into a free buffer and queues it for drawing.
+	// Blocks while both buffers are in use (render thread behind by a frame).
+	void Submit(const ImDrawData* drawData);
+
+	// GL submission time of the last drawn frame, ms (swap not included).
+	std::atomic<float> lastRenderMs;
+	// ImGui_ImplOpenGL3_GetRenderStats() totals after the last drawn frame.
+	std::atomic<uint64_t> uploadedBytes;
+	std::atomic<uint32_t> bufferAllocs;
+	std::atomic<uint32_t> mapStalls;
+	std::atomic<uint64_t> drawCmds;
+	std::atomic<uint64_t> drawCalls;
+	// Glyphs added by the GUI thread are uploaded here, set before Start().
+	DynamicFontAtlas* fontAtlas;
+
+private:
+	void renderLoop(void);
+
+	GLFWwindow* window;
+	DrawDataCopy buffers[2];
+	bool busy[2];
+	int writeIndex;
+	// Buffer waiting to be drawn, -1 if none.
+	int pending;
+	bool needStop;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::thread* thread;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// -----------------------------
+// Bounded lock-free channel from one producer thread to one consumer
+// thread. Capacity is a power of two; Push fails instead of waiting when
+// the channel is full. Each side keeps a cached copy of the other side's
+// index, so it only reads the shared one when its copy says full or empty.
+// -----------------------------
+template <typename T, size_t Capacity>
+class SpscChannel
+{
+public:
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscChannel capacity must be a power of two.");
+
+	SpscChannel()
+		: head(0), cachedTail(0), tail(0), cachedHead(0)
+	{
+	}
+
+	// Producer thread only.
+	bool Push(const T& item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - cachedHead == Capacity)
+		{
+			cachedHead = head.load(std::memory_order_acquire);
+			if (t - cachedHead == Capacity)
+			{
+				return false;
+			}
+		}
+		items[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer thread only.
+	bool Pop(T& item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == cachedTail)
+		{
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (h == cachedTail)
+			{
+				return false;
+			}
+		}
+		item = items[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Any thread, a hint only.
+	bool Empty(void) const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+private:
+	// Written by the consumer, on its own cache line with its copy of tail.
+	alignas(64) std::atomic<size_t> head;
+	size_t cachedTail;
+	// Written by the producer.
+	alignas(64) std::atomic<size_t> tail;
+	size_t cachedHead;
+	alignas(64) T items[Capacity];
+};
@@ -0,0 +1,299 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// -----------------------------
+// Hierarchical timer wheel: LEVELS wheels of SLOTS slots, one millisecond
+// tick per slot on the first wheel, each next wheel SLOTS times coarser.
+// Schedule and Cancel are O(1); a timer moves down one wheel when its slot
+// comes round. Deadlines are rounded up to the tick, so timers never fire
+// early. Not thread safe, Events guards it with a mutex.
+// -----------------------------
+template <typename Payload>
+class TimerWheel
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	// 0 is never returned by Schedule().
+	using TimerId = uint64_t;
+
+	static const int LEVEL_BITS = 6;
+	static const int SLOTS = 1 << LEVEL_BITS;
+	static const int LEVELS = 4;
+
+	explicit TimerWheel(Clock::time_point origin = Clock::now())
+		: origin(origin), currentTick(0), freeHead(-1), count(0)
+	{
+		heads.assign(LEVELS * SLOTS, -1);
+	}
+
+	// A zero period makes a one-shot timer.
+	TimerId Schedule(Clock::time_point deadline, Clock::duration period, const Payload& payload)
+	{
+		int index = freeHead;
+		if (index >= 0)
+		{
+			freeHead = timers[index].next;
+			timers[index].payload = payload;
+		}
+		else
+		{
+			index = (int)timers.size();
+			timers.push_back(Timer(payload));
+		}
+		Timer& t = timers[index];
+		t.deadline = deadline;
+		t.period = period;
+		insert(index, currentTick + 1);
+		++count;
+		return ((TimerId)t.generation << 32) | (TimerId)(index + 1);
+	}
+
+	// False if the timer already fired (one-shot) or was cancelled.
+	bool Cancel(TimerId id)
+	{
+		int index = (int)(id & 0xffffffffu) - 1;
+		if (index < 0 || index >= (int)timers.size())
+		{
+			return false;
+		}
+		Timer& t = timers[index];
+		if (t.slot < 0 || t.generation != (uint32_t)(id >> 32))
+		{
+			return false;
+		}
+		unlink(index);
+		release(index);
+		return true;
+	}
+
+	// Fires the timers due at now, fire(payload, deadline) in deadline order,
+	// and reschedules the periodic ones.
+	template <typename F>
+	void Advance(Clock::time_point now, F&& fire)
+	{
+		uint64_t target = tickFloor(now);
+		while (currentTick < target)
+		{
+			// Nothing to do until the next due timer or cascade.
+			uint64_t next = nextTick();
+			if (next > target)
+			{
+				currentTick = target;
+				break;
+			}
+			currentTick = next;
+			cascade();
+			fireSlot(now, fire);
+		}
+	}
+
+	// When Advance() next has work, a due timer or a cascade;
+	// Clock::time_point::max() without timers.
+	Clock::time_point NextWakeup() const
+	{
+		uint64_t next = nextTick();
+		if (next == UINT64_MAX)
+		{
+			return Clock::time_point::max();
+		}
+		return origin + std::chrono::milliseconds(next);
+	}
+
+	size_t Size() const
+	{
+		return count;
+	}
+
+private:
+	struct Timer
+	{
+		explicit Timer(const Payload& payload)
+			: payload(payload), expireTick(0), generation(1), prev(-1), next(-1), slot(-1)
+		{
+		}
+
+		Payload payload;
+		Clock::time_point deadline;
+		Clock::duration period;
+		uint64_t expireTick;
+		uint32_t generation;
+		int prev;
+		int next;
+		// Index into heads, -1 when not scheduled.
+		int slot;
+	};
+
+	uint64_t tickFloor(Clock::time_point t) const
+	{
+		if (t <= origin)
+		{
+			return 0;
+		}
+		return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(t - origin).count();
+	}
+
+	uint64_t tickCeil(Clock::time_point t) const
+	{
+		if (t <= origin)
+		{
+			return 0;
+		}
+		return (uint64_t)std::chrono::ceil<std::chrono::milliseconds>(t - origin).count();
+	}
+
+	// Ticks before minTick have been processed already.
+	void insert(int index, uint64_t minTick)
+	{
+		Timer& t = timers[index];
+		t.expireTick = std::max(tickCeil(t.deadline), minTick);
+		uint64_t delta = t.expireTick - currentTick;
+		int level = 0;
+		while (level < LEVELS - 1 && delta >= ((uint64_t)1 << (LEVEL_BITS * (level + 1))))
+		{
+			++level;
+		}
+		uint64_t tick = t.expireTick;
+		if (delta >= ((uint64_t)1 << (LEVEL_BITS * LEVELS)))
+		{
+			// Beyond the last wheel: park in its farthest slot, reinserted on cascade.
+			tick = currentTick + ((uint64_t)1 << (LEVEL_BITS * LEVELS)) - 1;
+		}
+		int slot = level * SLOTS + (int)((tick >> (LEVEL_BITS * level)) & (SLOTS - 1));
+		t.slot = slot;
+		t.prev = -1;
+		t.next = heads[slot];
+		if (t.next >= 0)
+		{
+			timers[t.next].prev = index;
+		}
+		heads[slot] = index;
+	}
+
+	void unlink(int index)
+	{
+		Timer& t = timers[index];
+		if (t.prev >= 0)
+		{
+			timers[t.prev].next = t.next;
+		}
+		else
+		{
+			heads[t.slot] = t.next;
+		}
+		if (t.next >= 0)
+		{
+			timers[t.next].prev = t.prev;
+		}
+		t.slot = -1;
+	}
+
+	void release(int index)
+	{
+		Timer& t = timers[index];
+		++t.generation;
+		t.next = freeHead;
+		freeHead = index;
+		--count;
+	}
+
+	// Detaches the list of a slot, returns its first timer.
+	int takeSlot(int slot)
+	{
+		int first = heads[slot];
+		heads[slot] = -1;
+		for (int i = first; i >= 0; i = timers[i].next)
+		{
+			timers[i].slot = -1;
+		}
+		return first;
+	}
+
+	// Moves the timers of the coarser wheels whose slot starts at currentTick down.
+	void cascade()
+	{
+		for (int level = 1; level < LEVELS; ++level)
+		{
+			if ((currentTick & (((uint64_t)1 << (LEVEL_BITS * level)) - 1)) != 0)
+			{
+				break;
+			}
+			int slot = level * SLOTS + (int)((currentTick >> (LEVEL_BITS * level)) & (SLOTS - 1));
+			for (int i = takeSlot(slot); i >= 0; )
+			{
+				int next = timers[i].next;
+				// Due at currentTick: lands in the slot fired next.
+				insert(i, currentTick);
+				i = next;
+			}
+		}
+	}
+
+	template <typename F>
+	void fireSlot(Clock::time_point now, F& fire)
+	{
+		due.clear();
+		for (int i = takeSlot((int)(currentTick & (SLOTS - 1))); i >= 0; i = timers[i].next)
+		{
+			due.push_back(i);
+		}
+		std::sort(due.begin(), due.end(), [this](int a, int b)
+		{
+			return timers[a].deadline < timers[b].deadline;
+		});
+		for (int index : due)
+		{
+			// fire() may schedule timers, which can move the pool.
+			Payload payload = timers[index].payload;
+			fire(payload, timers[index].deadline);
+			Timer& t = timers[index];
+			if (t.period > Clock::duration::zero())
+			{
+				// Keep the phase; periods missed entirely are skipped.
+				t.deadline += t.period;
+				if (t.deadline <= now)
+				{
+					t.deadline += t.period * ((now - t.deadline) / t.period + 1);
+				}
+				insert(index, currentTick + 1);
+			}
+			else
+			{
+				release(index);
+			}
+		}
+	}
+
+	uint64_t nextTick() const
+	{
+		if (count == 0)
+		{
+			return UINT64_MAX;
+		}
+		uint64_t best = UINT64_MAX;
+		for (int level = 0; level < LEVELS; ++level)
+		{
+			int shift = LEVEL_BITS * level;
+			for (uint64_t i = 1; i <= SLOTS; ++i)
+			{
+				uint64_t block = (currentTick >> shift) + i;
+				if (heads[level * SLOTS + (int)(block & (SLOTS - 1))] >= 0)
+				{
+					best = std::min(best, block << shift);
+					break;
+				}
+			}
+		}
+		return best;
+	}
+
+	Clock::time_point origin;
+	uint64_t currentTick;
+	std::vector<Timer> timers;
+	std::vector<int> heads;
+	std::vector<int> due;
+	int freeHead;
+	size_t count;
+};
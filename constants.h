@@ -7,6 +7,45 @@ namespace constants
     const int WINDOW_WIDTH = 1024;
     const int WINDOW_HEIGHT = 768;
     const int EVENT_TYPE_GUI = 1;
+    // Posted by Events::Stop() to wake the events loop.
+    const int EVENT_TYPE_WAKEUP = 2;
+    // Fired every DATA_DELAY_MS by the Events timer wheel, device polling
+    // listens to it.
+    const int EVENT_TYPE_DATA_POLL = 3;
+    // Longest sleep of the events loop without events, a safety net only:
+    // enqueue and Events::Stop() wake it at once.
+    const int EVENTS_WAIT_TIMEOUT_MS = 1000;
+    // Longest the events loop dispatches queued commands before it gets back
+    // to its own work, the rest of a burst is dispatched on the next pass.
+    const int EVENTS_DISPATCH_SLICE_US = 2000;
+    // Most dispatch worker threads Events::Run() starts (--event-workers).
+    const int MAX_EVENT_WORKERS = 8;
+    // Ordering keys: events with the same key are dispatched one after the
+    // other by the same worker, see Events::OrderingKey().
+    const int ORDER_KEY_DEVICE = 1;
+    const int ORDER_KEY_FILES = 2;
+    // Event types Events::SetQueueBound() accepts: 0 .. MAX_EVENT_TYPES - 1.
+    const int MAX_EVENT_TYPES = 8;
+    // What Events::Enqueue() does with an event whose type already has
+    // its capacity of events pending.
+    // Waits up to EVENT_BLOCK_TIMEOUT_MS for room, then drops the event.
+    // The dispatching threads never wait, they drop at once.
+    const int QUEUE_OVERFLOW_BLOCK = 0;
+    // Discards the pending event of the type queued first, in whichever
+    // queue or shard it waits.
+    const int QUEUE_OVERFLOW_DROP_OLDEST = 1;
+    const int QUEUE_OVERFLOW_DROP_NEWEST = 2;
+    // Merges the event into one pending overflow event of the type, the
+    // newest wins: at most capacity + 1 events are stored per priority.
+    const int QUEUE_OVERFLOW_COALESCE = 3;
+    const int EVENT_BLOCK_TIMEOUT_MS = 200;
+    // Coalescing keys of the overflow events, one per type, above the
+    // GUI command codes Events::CoalesceKey() uses.
+    const int COALESCE_KEY_OVERFLOW = 1000;
+    // Default bounds: commands wait for a stalled handler, polls only
+    // need the latest one.
+    const int EVENT_QUEUE_CAPACITY_GUI = 1024;
+    const int EVENT_QUEUE_CAPACITY_DATA_POLL = 2;
 
     const int  GUI_COMMAND_NONE = 0;
     const int  GUI_COMMAND_NEW = 1;
@@ -23,11 +62,60 @@ namespace constants
     const int  GUI_COMMAND_EXIT = 11;
     const int  GUI_COMMAND_JUMP_TO_CURSOR = 12;
     const int  GUI_COMMAND_MANUAL = 13;
+    // Code of the EVENT_TYPE_DATA_POLL events, after the GUI commands so
+    // the latency panels name it.
+    const int  EVENT_CODE_DATA_POLL = 14;
+    // Kinds of the updates Events posts to the GUI thread, see GuiUpdate.
+    // Status bar text.
+    const int  GUI_UPDATE_STATUS = 1;
+    // Device state in code: 0 disconnected, 1 connected.
+    const int  GUI_UPDATE_DEVICE = 2;
+    // A file finished loading, the text is its path.
+    const int  GUI_UPDATE_FILE_LOADED = 3;
+    const int  GUI_UPDATE_ERROR = 4;
+    const int  GUI_UPDATE_TEXT_LENGTH = 128;
+    // Updates each Events thread can have pending before it drops them,
+    // a power of two.
+    const int  GUI_UPDATE_CHANNEL_CAPACITY = 256;
+    // Most updates render() applies per frame, the rest wait for the next one.
+    const int  GUI_UPDATES_PER_FRAME = 64;
+    // Records of a new event journal (--journal), 48 bytes each. An
+    // existing journal keeps its size.
+    const int  EVENT_JOURNAL_RECORDS = 1 << 20;
+    // Event bridge (--bridge) frames: a little-endian uint32 length of what
+    // follows, a uint16 message type, then its body.
+    // Client: N records { int32 type, int32 code, int32 priority }, each
+    // queued with Events::TryEnqueue(): the bridge never waits for room,
+    // records a full bound refuses are acked as dropped.
+    const int  BRIDGE_MSG_ENQUEUE = 1;
+    // Client, no body: GUI updates are sent to the client from then on.
+    const int  BRIDGE_MSG_SUBSCRIBE = 2;
+    // Server, one per ENQUEUE frame: { uint32 queued, uint32 dropped }.
+    const int  BRIDGE_MSG_ACK = 16;
+    // Server: { int32 kind, int32 code } and the UTF-8 text of a GuiUpdate.
+    const int  BRIDGE_MSG_UPDATE = 17;
+    // Longer frames close the connection.
+    const int  BRIDGE_MAX_FRAME_BYTES = 1 << 20;
+    const int  BRIDGE_READ_CHUNK_BYTES = 64 * 1024;
+    // A client that lets more replies than this pile up is disconnected.
+    const int  BRIDGE_MAX_PENDING_BYTES = 16 << 20;
     const int  MAX_CELL_TEXT_LENGTH = 1024;
 
     const int  DATA_CHANNELS = 8;
     const int  DATA_DELAY_MS = 100;
 
+    // Idle rendering: longest sleep between frames when nothing happens
+    // (the status bar clock has one second resolution) and the number of
+    // frames drawn after the last input so hover/press states settle.
+    const int  IDLE_WAIT_TIMEOUT_MS = 1000;
+    const int  IDLE_CATCHUP_FRAMES = 3;
+
+    // Side of the font texture in the dynamic font atlas mode, pixels.
+    const int  FONT_ATLAS_DYNAMIC_SIZE = 512;
+    // Rasterization size of every face in the SDF font mode, pixels.
+    // Other sizes are drawn by scaling (ImFont::Scale, io.FontGlobalScale).
+    const float FONT_SDF_BASE_SIZE = 24.0f;
+
     const float TABLE_COLOR_CURRENT_ROW_R = 0.5;
     const float TABLE_COLOR_CURRENT_ROW_G = 0.5;
     const float TABLE_COLOR_CURRENT_ROW_B = 1.0;
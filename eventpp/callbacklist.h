@@ -16,6 +16,7 @@
 
 #include "eventpolicies.h"
 #include "internal/typeutil_i.h"
+#include "internal/vectorcallbacklist_i.h"
 
 #include <atomic>
 #include <condition_variable>
@@ -450,6 +451,11 @@ private:
 };
 
 
+template <typename Prototype_, typename Policies_, bool>
+struct SelectCallbackListBase { using Type = VectorCallbackListBase<Prototype_, Policies_>; };
+template <typename Prototype_, typename Policies_>
+struct SelectCallbackListBase <Prototype_, Policies_, false> { using Type = CallbackListBase<Prototype_, Policies_>; };
+
 } //namespace internal_
 
 
@@ -457,10 +463,14 @@ template <
 	typename Prototype_,
 	typename Policies_ = DefaultPolicies
 >
-class CallbackList : public internal_::CallbackListBase<Prototype_, Policies_>, public TagCallbackList
+class CallbackList : public internal_::SelectCallbackListBase<
+		Prototype_, Policies_, internal_::HasTypeCallbackStorage<Policies_>::value
+	>::Type, public TagCallbackList
 {
 private:
-	using super = internal_::CallbackListBase<Prototype_, Policies_>;
+	using super = typename internal_::SelectCallbackListBase<
+		Prototype_, Policies_, internal_::HasTypeCallbackStorage<Policies_>::value
+	>::Type;
 	
 public:
 	using super::super;
@@ -178,6 +178,34 @@ struct MixinList
 {
 };
 
+// Policy type `QueueRing` selecting the EventQueue storage: a bounded lock-free ring
+// for any number of producer threads and one consumer thread, FIFO order.
+// Capacity is rounded up to a power of two. enqueue() yields while the ring is full,
+// so a listener must not enqueue into its own full queue.
+template <size_t Capacity>
+struct MpscRing
+{
+	static constexpr size_t capacity = Capacity;
+};
+
+// Policy type `QueueRing` selecting the HeterEventQueue storage: the queued events are
+// variable sized records in a byte ring of Capacity bytes (rounded up to a power of two),
+// the arguments constructed in place, nothing allocated per event. FIFO order.
+// enqueue() yields while the ring is full, so a listener must not enqueue into its own full queue.
+template <size_t Capacity>
+struct ByteRing
+{
+	static constexpr size_t capacity = Capacity;
+};
+
+// Policy type `CallbackStorage` selecting the CallbackList storage: the callbacks of a list
+// in one contiguous vector, walked by index, without per-node reference counting.
+// A change publishes a new vector; a dispatch walks the one of its epoch without locking,
+// and replaced vectors are freed once the epochs of the dispatches that can see them end.
+struct CallbackVector
+{
+};
+
 #include "internal/eventpolicies_i.h"
 
 
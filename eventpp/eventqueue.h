@@ -16,6 +16,7 @@
 
 #include "eventdispatcher.h"
 #include "internal/eventqueue_i.h"
+#include "internal/mpsceventqueue_i.h"
 
 #include <list>
 #include <tuple>
@@ -23,6 +24,7 @@
 #include <mutex>
 #include <array>
 #include <cassert>
+#include <iterator>
 
 namespace eventpp {
 
@@ -192,6 +194,52 @@ public:
 		}
 	}
 
+	// Enqueues one event for each element of range, the element being the only argument.
+	// The free list and the queue list are locked once for the whole range.
+	template <typename Range>
+	void enqueueBatch(const typename super::Event & e, const Range & range)
+	{
+		static_assert(sizeof...(Args) == 1 && super::ArgumentPassingMode::canExcludeEventType, "enqueueBatch requires one argument besides the event type.");
+
+		using std::begin;
+		using std::end;
+		const auto first = begin(range);
+		const auto last = end(range);
+		const size_t count = static_cast<size_t>(std::distance(first, last));
+		if(count == 0) {
+			return;
+		}
+
+		BufferedItemList tempList;
+		size_t taken = 0;
+		if(! freeList.empty()) {
+			std::lock_guard<Mutex> queueListLock(freeListMutex);
+			while(taken < count && ! freeList.empty()) {
+				tempList.splice(tempList.end(), freeList, freeList.begin());
+				++taken;
+			}
+		}
+		for(; taken < count; ++taken) {
+			tempList.emplace_back();
+		}
+
+		auto from = first;
+		for(auto & item : tempList) {
+			item.set(QueuedEvent{ e, QueuedEventArgumentsType(*from) });
+			++from;
+		}
+
+		{
+			std::lock_guard<Mutex> queueListLock(queueListMutex);
+			queueList.splice(queueList.end(), tempList);
+		}
+		doRecycle(tempList);
+
+		if(doCanProcess()) {
+			queueListConditionVariable.notify_one();
+		}
+	}
+
 	bool emptyQueue() const
 	{
 		return queueList.empty() && (queueEmptyCounter.load(std::memory_order_acquire) == 0);
@@ -285,6 +333,91 @@ public:
 		return false;
 	}
 
+	// Dispatches at most count events, the rest stay queued.
+	bool processUpTo(size_t count)
+	{
+		if(count > 0 && ! queueList.empty()) {
+			BufferedItemList tempList;
+
+			// Use a counter to tell the queue list is not empty during processing
+			// even though queueList is swapped to empty.
+			CounterGuard<decltype(queueEmptyCounter)> counterGuard(queueEmptyCounter);
+
+			{
+				std::lock_guard<Mutex> queueListLock(queueListMutex);
+				for(size_t i = 0; i < count && ! queueList.empty(); ++i) {
+					tempList.splice(tempList.end(), queueList, queueList.begin());
+				}
+			}
+
+			if(! tempList.empty()) {
+				for(auto & item : tempList) {
+					doDispatchQueuedEvent(
+						item.get(),
+						typename MakeIndexSequence<sizeof...(Args)>::Type()
+					);
+					item.clear();
+				}
+
+				std::lock_guard<Mutex> queueListLock(freeListMutex);
+				freeList.splice(freeList.end(), tempList);
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Dispatches events until duration has elapsed, checked after each event, so at least
+	// one event is dispatched if any is queued. The rest stay queued, ahead of the events
+	// enqueued meanwhile.
+	template <class Rep, class Period>
+	bool processFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		if(! queueList.empty()) {
+			BufferedItemList tempList;
+			BufferedItemList idleList;
+
+			// Use a counter to tell the queue list is not empty during processing
+			// even though queueList is swapped to empty.
+			CounterGuard<decltype(queueEmptyCounter)> counterGuard(queueEmptyCounter);
+
+			{
+				std::lock_guard<Mutex> queueListLock(queueListMutex);
+				std::swap(queueList, tempList);
+			}
+
+			if(! tempList.empty()) {
+				const auto deadline = std::chrono::steady_clock::now() + duration;
+				do {
+					auto it = tempList.begin();
+					doDispatchQueuedEvent(
+						it->get(),
+						typename MakeIndexSequence<sizeof...(Args)>::Type()
+					);
+					it->clear();
+					idleList.splice(idleList.end(), tempList, it);
+				} while(! tempList.empty() && std::chrono::steady_clock::now() < deadline);
+
+				if(! tempList.empty()) {
+					std::lock_guard<Mutex> queueListLock(queueListMutex);
+					tempList.splice(tempList.end(), queueList);
+					std::swap(queueList, tempList);
+				}
+				// Items a coalescing list merged into the rest.
+				idleList.splice(idleList.end(), tempList);
+
+				std::lock_guard<Mutex> queueListLock(freeListMutex);
+				freeList.splice(freeList.end(), idleList);
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	template <typename F>
 	bool processIf(F && func)
 	{
@@ -323,17 +456,23 @@ public:
 					}
 				}
 
+				const bool processed = ! idleList.empty();
+
+				// The rest goes back ahead of the events enqueued meanwhile, which are
+				// spliced after it so a priority or coalescing list sees them as newer.
 				if (! tempList.empty()) {
 					std::lock_guard<Mutex> queueListLock(queueListMutex);
-					queueList.splice(queueList.begin(), tempList);
+					tempList.splice(tempList.end(), queueList);
+					std::swap(queueList, tempList);
 				}
+				idleList.splice(idleList.end(), tempList);
 
 				if(! idleList.empty()) {
 					std::lock_guard<Mutex> queueListLock(freeListMutex);
 					freeList.splice(freeList.end(), idleList);
-					
-					return true;
 				}
+
+				return processed;
 			}
 		}
 		
@@ -410,6 +549,59 @@ public:
 		return false;
 	}
 
+	// Calls func(queuedEvent) for each queued event, in dispatch order, with the queue locked,
+	// so func must not use the queue. Events already taken by a running process() aren't seen.
+	template <typename F>
+	void forEachQueued(F && func) const
+	{
+		if(queueList.empty()) {
+			return;
+		}
+
+		std::lock_guard<Mutex> queueListLock(queueListMutex);
+		for(const auto & item : queueList) {
+			if(! item.empty()) {
+				func(item.get());
+			}
+		}
+	}
+
+	// Removes the first queued event, in dispatch order, for which func(queuedEvent) returns
+	// true, without dispatching it. If discarded isn't nullptr it receives the event.
+	// Events already taken by a running process() aren't seen.
+	template <typename F>
+	bool discardOneIf(F && func, QueuedEvent * discarded = nullptr)
+	{
+		if(queueList.empty()) {
+			return false;
+		}
+
+		BufferedItemList idleList;
+		{
+			std::lock_guard<Mutex> queueListLock(queueListMutex);
+			for(auto it = queueList.begin(); it != queueList.end(); ++it) {
+				if(it->empty()) {
+					continue;
+				}
+				const QueuedEvent & queuedEvent = it->get();
+				if(func(queuedEvent)) {
+					if(discarded != nullptr) {
+						*discarded = queuedEvent;
+					}
+					it->clear();
+					idleList.splice(idleList.end(), queueList, it);
+					break;
+				}
+			}
+		}
+
+		if(idleList.empty()) {
+			return false;
+		}
+		doRecycle(idleList);
+		return true;
+	}
+
 protected:
 	bool doCanProcess() const
 	{
@@ -458,8 +650,20 @@ protected:
 		auto it = tempList.begin();
 		it->set(std::move(item));
 
-		std::lock_guard<Mutex> queueListLock(queueListMutex);
-		queueList.splice(queueList.end(), tempList, it);
+		{
+			std::lock_guard<Mutex> queueListLock(queueListMutex);
+			queueList.splice(queueList.end(), tempList, it);
+		}
+		doRecycle(tempList);
+	}
+
+	// A coalescing QueueList leaves the node of a merged event, cleared, in the source list.
+	void doRecycle(BufferedItemList & list)
+	{
+		if(! list.empty()) {
+			std::lock_guard<Mutex> queueListLock(freeListMutex);
+			freeList.splice(freeList.end(), list);
+		}
 	}
 
 private:
@@ -472,6 +676,11 @@ private:
 	BufferedItemList freeList;
 };
 
+template <typename Event_, typename Prototype_, typename Policies_, bool>
+struct SelectEventQueueBase { using Type = MpscEventQueueBase<Event_, Prototype_, Policies_>; };
+template <typename Event_, typename Prototype_, typename Policies_>
+struct SelectEventQueueBase <Event_, Prototype_, Policies_, false> { using Type = EventQueueBase<Event_, Prototype_, Policies_>; };
+
 } //namespace internal_
 
 template <
@@ -480,13 +689,13 @@ template <
 	typename Policies_ = DefaultPolicies
 >
 class EventQueue : public internal_::InheritMixins<
-		internal_::EventQueueBase<Event_, Prototype_, Policies_>,
+		typename internal_::SelectEventQueueBase<Event_, Prototype_, Policies_, internal_::HasTypeQueueRing<Policies_>::value>::Type,
 		typename internal_::SelectMixins<Policies_, internal_::HasTypeMixins<Policies_>::value >::Type
 	>::Type, public TagEventDispatcher, public TagEventQueue
 {
 private:
 	using super = typename internal_::InheritMixins<
-		internal_::EventQueueBase<Event_, Prototype_, Policies_>,
+		typename internal_::SelectEventQueueBase<Event_, Prototype_, Policies_, internal_::HasTypeQueueRing<Policies_>::value>::Type,
 		typename internal_::SelectMixins<Policies_, internal_::HasTypeMixins<Policies_>::value >::Type
 	>::Type;
 
@@ -18,6 +18,7 @@
 
 // temp, should move the internal code in eventqueue to separated file
 #include "eventqueue.h"
+#include "internal/byteringqueue_i.h"
 
 namespace eventpp {
 
@@ -451,6 +452,10 @@ private:
 };
 
 
+template <typename Event_, typename PrototypeList_, typename Policies_, bool>
+struct SelectHeterEventQueueBase { using Type = ByteRingHeterEventQueueBase<Event_, PrototypeList_, Policies_>; };
+template <typename Event_, typename PrototypeList_, typename Policies_>
+struct SelectHeterEventQueueBase <Event_, PrototypeList_, Policies_, false> { using Type = HeterEventQueueBase<Event_, PrototypeList_, Policies_>; };
 
 } //namespace internal_
 
@@ -460,13 +465,13 @@ template <
 	typename Policies_ = DefaultPolicies
 >
 class HeterEventQueue : public internal_::InheritMixins<
-		internal_::HeterEventQueueBase<Event_, PrototypeList_, Policies_>,
+		typename internal_::SelectHeterEventQueueBase<Event_, PrototypeList_, Policies_, internal_::HasTypeQueueRing<Policies_>::value>::Type,
 		typename internal_::SelectMixins<Policies_, internal_::HasTypeMixins<Policies_>::value >::Type
 	>::Type, public TagEventDispatcher, public TagEventQueue, public TagHeterEventDispatcher, public TagHeterEventQueue
 {
 private:
 	using super = typename internal_::InheritMixins<
-		internal_::HeterEventQueueBase<Event_, PrototypeList_, Policies_>,
+		typename internal_::SelectHeterEventQueueBase<Event_, PrototypeList_, Policies_, internal_::HasTypeQueueRing<Policies_>::value>::Type,
 		typename internal_::SelectMixins<Policies_, internal_::HasTypeMixins<Policies_>::value >::Type
 	>::Type;
 
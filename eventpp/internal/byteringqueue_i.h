@@ -0,0 +1,431 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BYTERINGQUEUE_I_H
+#define BYTERINGQUEUE_I_H
+
+// Don't include this header, include hetereventqueue.h and use the ByteRing policy instead
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <tuple>
+
+namespace eventpp {
+
+namespace internal_ {
+
+// HeterEventQueue storage for the ByteRing policy.
+// Each queued event is one variable sized record in a byte ring: a header holding the
+// event type and two per-prototype trampolines (dispatch, destroy), followed by the
+// argument tuple constructed in place. Nothing is allocated per event.
+// Producers serialize on a mutex while they construct their record; the consumer
+// reads the records without locking. process(), processOne(), processUpTo(),
+// processFor() and clearEvents() must all be called from the one consumer thread.
+template <
+	typename EventType_,
+	typename PrototypeList_,
+	typename Policies_
+>
+class ByteRingHeterEventQueueBase : public HeterEventDispatcherBase<
+		EventType_,
+		PrototypeList_,
+		Policies_,
+		ByteRingHeterEventQueueBase <
+			EventType_,
+			PrototypeList_,
+			Policies_
+		>
+	>
+{
+private:
+	using super = HeterEventDispatcherBase<
+		EventType_,
+		PrototypeList_,
+		Policies_,
+		ByteRingHeterEventQueueBase <
+			EventType_,
+			PrototypeList_,
+			Policies_
+		>
+	>;
+
+	using Policies = typename super::Policies;
+	using Threading = typename super::Threading;
+	using ConditionVariable = typename Threading::ConditionVariable;
+	using ArgumentPassingMode = typename super::ArgumentPassingMode;
+
+	static_assert(std::is_same<typename Policies_::QueueRing, ByteRing<Policies_::QueueRing::capacity> >::value,
+		"HeterEventQueue requires QueueRing to be a ByteRing.");
+
+	struct RecordHeader;
+	using RecordDispatcher = void (*)(const ByteRingHeterEventQueueBase *, RecordHeader &);
+	using RecordDestroyer = void (*)(RecordHeader &);
+
+	struct RecordHeader
+	{
+		// Bytes up to the next record, header included.
+		size_t size;
+		// nullptr for the padding that skips the end of the buffer.
+		RecordDispatcher dispatcher;
+		RecordDestroyer destroyer;
+		typename std::decay<EventType_>::type event;
+	};
+
+	enum : size_t {
+		alignment = alignof(std::max_align_t),
+		payloadOffset = (sizeof(RecordHeader) + alignment - 1) / alignment * alignment
+	};
+
+	struct alignas(alignof(std::max_align_t)) Unit
+	{
+		unsigned char bytes[alignment];
+	};
+
+	static constexpr size_t doAlign(const size_t n) {
+		return (n + alignment - 1) / alignment * alignment;
+	}
+
+	static constexpr size_t doRoundCapacity(const size_t n) {
+		return n <= alignment ? alignment : 2 * doRoundCapacity((n + 1) / 2);
+	}
+
+	static constexpr size_t capacity = doRoundCapacity(Policies_::QueueRing::capacity);
+
+	template <typename ...Args>
+	struct RecordSizer
+	{
+		unsigned char header[payloadOffset];
+		std::tuple<typename std::remove_cv<typename std::remove_reference<Args>::type>::type...> arguments;
+	};
+
+	// A record can always be placed once the ring is drained, whatever the wrap point.
+	static_assert(doAlign(GetCallablePrototypeMaxSize<PrototypeList_, RecordSizer>::value) <= capacity / 2,
+		"ByteRing capacity must be at least twice the largest record.");
+
+public:
+	using Event = typename super::Event;
+	using Handle = typename super::Handle;
+	using Mutex = typename super::Mutex;
+
+public:
+	ByteRingHeterEventQueueBase()
+		:
+			super(),
+			buffer(new Unit[capacity / alignment]),
+			writePosition(0),
+			readPosition(0),
+			consumerWaiting(false),
+			fullWaitCount(0),
+			producerMutex(),
+			waitConditionVariable()
+	{
+	}
+
+	~ByteRingHeterEventQueueBase()
+	{
+		clearEvents();
+	}
+
+	ByteRingHeterEventQueueBase(const ByteRingHeterEventQueueBase &) = delete;
+	ByteRingHeterEventQueueBase & operator = (const ByteRingHeterEventQueueBase &) = delete;
+
+	template <typename T, typename ...Args>
+	void enqueue(T && first, Args && ...args)
+	{
+		doEnqueue<ArgumentPassingMode>(std::forward<T>(first), std::forward<Args>(args)...);
+	}
+
+	bool emptyQueue() const
+	{
+		return ! doCanProcess();
+	}
+
+	void clearEvents()
+	{
+		RecordHeader * header;
+		while((header = doNextRecord()) != nullptr) {
+			doRelease(*header);
+		}
+	}
+
+	// Dispatches the events published when it starts, the ones enqueued meanwhile wait for the next call.
+	bool process()
+	{
+		const size_t end = writePosition.load(std::memory_order_acquire);
+		bool processed = false;
+		while(readPosition.load(std::memory_order_relaxed) != end && processOne()) {
+			processed = true;
+		}
+		return processed;
+	}
+
+	bool processUpTo(size_t count)
+	{
+		size_t processed = 0;
+		while(processed < count && processOne()) {
+			++processed;
+		}
+		return processed > 0;
+	}
+
+	// Stops once duration has elapsed, checked after each event.
+	template <class Rep, class Period>
+	bool processFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + duration;
+		if(! processOne()) {
+			return false;
+		}
+		while(std::chrono::steady_clock::now() < deadline && processOne()) {
+		}
+		return true;
+	}
+
+	bool processOne()
+	{
+		RecordHeader * header = doNextRecord();
+		if(header == nullptr) {
+			return false;
+		}
+
+		// The record stays in the ring while the listeners run, producers can't reuse its bytes.
+		ReleaseGuard guard(this, *header);
+		header->dispatcher(this, *header);
+		return true;
+	}
+
+	void wait() const
+	{
+		if(doCanProcess()) {
+			return;
+		}
+		std::unique_lock<Mutex> lock(producerMutex);
+		consumerWaiting = true;
+		waitConditionVariable.wait(lock, [this]() -> bool {
+			return doCanProcess();
+		});
+		consumerWaiting = false;
+	}
+
+	template <class Rep, class Period>
+	bool waitFor(const std::chrono::duration<Rep, Period> & duration) const
+	{
+		if(doCanProcess()) {
+			return true;
+		}
+		std::unique_lock<Mutex> lock(producerMutex);
+		consumerWaiting = true;
+		const bool result = waitConditionVariable.wait_for(lock, duration, [this]() -> bool {
+			return doCanProcess();
+		});
+		consumerWaiting = false;
+		return result;
+	}
+
+	using super::dispatch;
+
+	// enqueue() calls that found the ring full and had to yield.
+	size_t getFullWaitCount() const
+	{
+		return fullWaitCount.load(std::memory_order_relaxed);
+	}
+
+	static constexpr size_t getCapacity()
+	{
+		return capacity;
+	}
+
+private:
+	struct ReleaseGuard
+	{
+		ReleaseGuard(ByteRingHeterEventQueueBase * queue, RecordHeader & header) : queue(queue), header(header) {
+		}
+
+		~ReleaseGuard() {
+			queue->doRelease(header);
+		}
+
+		ByteRingHeterEventQueueBase * queue;
+		RecordHeader & header;
+	};
+
+	bool doCanProcess() const
+	{
+		return readPosition.load(std::memory_order_acquire) != writePosition.load(std::memory_order_acquire);
+	}
+
+	unsigned char * doAt(const size_t position) const
+	{
+		return reinterpret_cast<unsigned char *>(buffer.get()) + (position & (capacity - 1));
+	}
+
+	// Skips the padding, nullptr when no record is published.
+	RecordHeader * doNextRecord()
+	{
+		const size_t end = writePosition.load(std::memory_order_acquire);
+		size_t position = readPosition.load(std::memory_order_relaxed);
+		while(position != end) {
+			const size_t remaining = capacity - (position & (capacity - 1));
+			if(remaining < sizeof(RecordHeader)) {
+				position += remaining;
+				readPosition.store(position, std::memory_order_release);
+				continue;
+			}
+			RecordHeader * header = reinterpret_cast<RecordHeader *>(doAt(position));
+			if(header->dispatcher == nullptr) {
+				position += header->size;
+				header->~RecordHeader();
+				readPosition.store(position, std::memory_order_release);
+				continue;
+			}
+			return header;
+		}
+		return nullptr;
+	}
+
+	// header is the record at readPosition.
+	void doRelease(RecordHeader & header)
+	{
+		const size_t size = header.size;
+		header.destroyer(header);
+		header.~RecordHeader();
+		readPosition.store(readPosition.load(std::memory_order_relaxed) + size, std::memory_order_release);
+	}
+
+	template <typename ArgsTuple>
+	static ArgsTuple & doGetArguments(RecordHeader & header)
+	{
+		return *reinterpret_cast<ArgsTuple *>(reinterpret_cast<unsigned char *>(&header) + payloadOffset);
+	}
+
+	template <typename PrototypeInfo>
+	static void doDispatchRecord(const ByteRingHeterEventQueueBase * self, RecordHeader & header)
+	{
+		using ArgsTuple = typename PrototypeInfo::ArgsTuple;
+		self->doDispatchArguments(
+			header.event,
+			doGetArguments<ArgsTuple>(header),
+			typename MakeIndexSequence<std::tuple_size<ArgsTuple>::value>::Type()
+		);
+	}
+
+	template <typename ArgsTuple>
+	static void doDestroyRecord(RecordHeader & header)
+	{
+		doGetArguments<ArgsTuple>(header).~ArgsTuple();
+	}
+
+	template <typename T, size_t ...Indexes>
+	void doDispatchArguments(const Event & event, T & arguments, IndexSequence<Indexes...>) const
+	{
+		this->directDispatch(event, std::get<Indexes>(arguments)...);
+	}
+
+	template <typename ArgumentMode, typename T, typename ...Args>
+	auto doEnqueue(T && first, Args && ...args)
+		-> typename std::enable_if<std::is_same<ArgumentMode, ArgumentPassingIncludeEvent>::value>::type
+	{
+		using GetEvent = typename SelectGetEvent<Policies_, EventType_, HasFunctionGetEvent<Policies_, T &&, Args...>::value>::Type;
+		using PrototypeInfo = FindPrototypeByArgs<PrototypeList_, T, Args...>;
+
+		static_assert(PrototypeInfo::index >= 0, "Can't find invoker for the given argument types.");
+		static_assert(std::tuple_size<typename PrototypeInfo::ArgsTuple>::value == 1 + sizeof...(Args), "Arguments count mismatch.");
+
+		const Event event = GetEvent::getEvent(std::forward<T>(first), args...);
+		doEnqueueRecord<PrototypeInfo>(event, std::forward<T>(first), std::forward<Args>(args)...);
+	}
+
+	template <typename ArgumentMode, typename T, typename ...Args>
+	auto doEnqueue(T && first, Args && ...args)
+		-> typename std::enable_if<std::is_same<ArgumentMode, ArgumentPassingExcludeEvent>::value>::type
+	{
+		using GetEvent = typename SelectGetEvent<Policies_, EventType_, HasFunctionGetEvent<Policies_, T &&, Args...>::value>::Type;
+		using PrototypeInfo = FindPrototypeByArgs<PrototypeList_, Args...>;
+
+		static_assert(PrototypeInfo::index >= 0, "Can't find invoker for the given argument types.");
+		static_assert(std::tuple_size<typename PrototypeInfo::ArgsTuple>::value == sizeof...(Args), "Arguments count mismatch.");
+
+		const Event event = GetEvent::getEvent(std::forward<T>(first), args...);
+		doEnqueueRecord<PrototypeInfo>(event, std::forward<Args>(args)...);
+	}
+
+	template <typename PrototypeInfo, typename ...Args>
+	void doEnqueueRecord(const Event & event, Args && ...args)
+	{
+		using ArgsTuple = typename PrototypeInfo::ArgsTuple;
+		const size_t size = doAlign(payloadOffset + sizeof(ArgsTuple));
+
+		std::unique_lock<Mutex> lock(producerMutex);
+		size_t position = writePosition.load(std::memory_order_relaxed);
+		size_t remaining = capacity - (position & (capacity - 1));
+		// Records never wrap: the bytes left at the end are skipped when too few.
+		size_t needed = size + (remaining < size ? remaining : 0);
+		bool waited = false;
+		while(capacity - (position - readPosition.load(std::memory_order_acquire)) < needed) {
+			// Full: wait for the consumer to release records.
+			lock.unlock();
+			waited = true;
+			std::this_thread::yield();
+			lock.lock();
+			position = writePosition.load(std::memory_order_relaxed);
+			remaining = capacity - (position & (capacity - 1));
+			needed = size + (remaining < size ? remaining : 0);
+		}
+		if(waited) {
+			fullWaitCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if(remaining < size) {
+			if(remaining >= sizeof(RecordHeader)) {
+				new (doAt(position)) RecordHeader{ remaining, nullptr, nullptr, event };
+			}
+			position += remaining;
+		}
+
+		unsigned char * record = doAt(position);
+		new (record + payloadOffset) ArgsTuple(std::forward<Args>(args)...);
+		new (record) RecordHeader{
+			size,
+			&ByteRingHeterEventQueueBase::doDispatchRecord<PrototypeInfo>,
+			&ByteRingHeterEventQueueBase::doDestroyRecord<ArgsTuple>,
+			event
+		};
+		writePosition.store(position + size, std::memory_order_release);
+
+		if(consumerWaiting) {
+			waitConditionVariable.notify_one();
+		}
+	}
+
+private:
+	std::unique_ptr<Unit[]> buffer;
+	// Byte counters, they only grow. A record starts at position & (capacity - 1).
+	std::atomic<size_t> writePosition;
+	std::atomic<size_t> readPosition;
+	// Guarded by producerMutex.
+	mutable bool consumerWaiting;
+	std::atomic<size_t> fullWaitCount;
+	mutable Mutex producerMutex;
+	mutable ConditionVariable waitConditionVariable;
+};
+
+
+} //namespace internal_
+
+} //namespace eventpp
+
+#endif
@@ -132,6 +132,25 @@ struct HasTypeMixins
 template <typename T, bool> struct SelectMixins { using Type = typename T::Mixins; };
 template <typename T> struct SelectMixins <T, false> { using Type = MixinList<>; };
 
+template <typename T>
+struct HasTypeQueueRing
+{
+	template <typename C> static std::true_type test(typename C::QueueRing *) ;
+	template <typename C> static std::false_type test(...);    
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
+
+template <typename T>
+struct HasTypeCallbackStorage
+{
+	template <typename C> static std::true_type test(typename C::CallbackStorage *) ;
+	template <typename C> static std::false_type test(...);    
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
 
 template <typename Root, typename TList>
 struct InheritMixins;
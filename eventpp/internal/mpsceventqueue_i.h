@@ -0,0 +1,397 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MPSCEVENTQUEUE_I_H
+#define MPSCEVENTQUEUE_I_H
+
+// Don't include this header, include eventqueue.h and use the MpscRing policy instead
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cstdint>
+
+namespace eventpp {
+
+namespace internal_ {
+
+// EventQueue storage for the MpscRing policy.
+// Producers claim a cell of a bounded ring with one compare-exchange and publish it through
+// the cell's sequence number (D. Vyukov's bounded queue), no mutex is taken unless the
+// consumer sleeps in wait()/waitFor(). process(), processOne(), takeEvent(), peekEvent() and
+// clearEvents() must all be called from the one consumer thread.
+template <
+	typename EventType_,
+	typename Prototype_,
+	typename Policies_
+>
+class MpscEventQueueBase;
+
+template <
+	typename EventType_,
+	typename Policies_,
+	typename ReturnType, typename ...Args
+>
+class MpscEventQueueBase <
+		EventType_,
+		ReturnType (Args...),
+		Policies_
+	> : public EventDispatcherBase<
+		EventType_,
+		ReturnType (Args...),
+		Policies_,
+		MpscEventQueueBase <
+			EventType_,
+			ReturnType (Args...),
+			Policies_
+		>
+	>
+{
+private:
+	using super = EventDispatcherBase<
+		EventType_,
+		ReturnType (Args...),
+		Policies_,
+		MpscEventQueueBase <
+			EventType_,
+			ReturnType (Args...),
+			Policies_
+		>
+	>;
+
+	using Threading = typename super::Threading;
+	using ConditionVariable = typename Threading::ConditionVariable;
+
+	static_assert(std::is_same<typename Policies_::QueueRing, MpscRing<Policies_::QueueRing::capacity> >::value,
+		"EventQueue requires QueueRing to be an MpscRing.");
+
+	using QueuedEventArgumentsType = std::tuple<typename std::decay<Args>::type...>;
+
+	struct QueuedEvent_
+	{
+		typename std::decay<typename super::Event>::type event;
+		QueuedEventArgumentsType arguments;
+
+		typename super::Event getEvent() const {
+			return event;
+		}
+
+		template <std::size_t N>
+		auto getArgument() const
+			-> typename std::tuple_element<N, std::tuple<Args...> >::type {
+			return std::get<N>(arguments);
+		}
+	};
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		BufferedItem<QueuedEvent_> item;
+	};
+
+	static constexpr size_t doRoundCapacity(size_t n) {
+		return n <= 2 ? 2 : 2 * doRoundCapacity((n + 1) / 2);
+	}
+
+	static constexpr size_t capacity = doRoundCapacity(Policies_::QueueRing::capacity);
+
+public:
+	using QueuedEvent = QueuedEvent_;
+	using Event = typename super::Event;
+	using Handle = typename super::Handle;
+	using Callback = typename super::Callback;
+	using Mutex = typename super::Mutex;
+
+public:
+	MpscEventQueueBase()
+		:
+			super(),
+			cells(new Cell[capacity]),
+			enqueuePosition(0),
+			dequeuePosition(0),
+			consumerWaiting(false),
+			fullWaitCount(0),
+			waitMutex(),
+			waitConditionVariable()
+	{
+		for(size_t i = 0; i < capacity; ++i) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	~MpscEventQueueBase()
+	{
+		clearEvents();
+	}
+
+	MpscEventQueueBase(const MpscEventQueueBase &) = delete;
+	MpscEventQueueBase & operator = (const MpscEventQueueBase &) = delete;
+
+	template <typename ...A>
+	auto enqueue(A ...args) -> typename std::enable_if<sizeof...(A) == sizeof...(Args), void>::type
+	{
+		static_assert(super::ArgumentPassingMode::canIncludeEventType, "Enqueuing arguments count doesn't match required (Event type should be included).");
+
+		using GetEvent = typename SelectGetEvent<Policies_, EventType_, HasFunctionGetEvent<Policies_, A...>::value>::Type;
+
+		doEnqueue(QueuedEvent{
+			GetEvent::getEvent(args...),
+			QueuedEventArgumentsType(std::forward<A>(args)...)
+		});
+	}
+
+	template <typename T, typename ...A>
+	auto enqueue(T && first, A ...args) -> typename std::enable_if<sizeof...(A) == sizeof...(Args), void>::type
+	{
+		static_assert(super::ArgumentPassingMode::canExcludeEventType, "Enqueuing arguments count doesn't match required (Event type should NOT be included).");
+
+		using GetEvent = typename SelectGetEvent<Policies_, EventType_, HasFunctionGetEvent<Policies_, T &&, A...>::value>::Type;
+
+		doEnqueue(QueuedEvent{
+			GetEvent::getEvent(std::forward<T>(first), args...),
+			QueuedEventArgumentsType(std::forward<A>(args)...)
+		});
+	}
+
+	// No lock to share here, the elements are enqueued one by one.
+	template <typename Range>
+	void enqueueBatch(const typename super::Event & e, const Range & range)
+	{
+		static_assert(sizeof...(Args) == 1 && super::ArgumentPassingMode::canExcludeEventType, "enqueueBatch requires one argument besides the event type.");
+
+		for(const auto & argument : range) {
+			doEnqueue(QueuedEvent{ e, QueuedEventArgumentsType(argument) });
+		}
+	}
+
+	// A cell claimed by a producer that has not finished writing it counts as empty.
+	bool emptyQueue() const
+	{
+		return ! doCanProcess();
+	}
+
+	void clearEvents()
+	{
+		while(doCanProcess()) {
+			const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+			doRelease(cells[position & (capacity - 1)], position);
+		}
+	}
+
+	// Dispatches the events published when it starts, the ones enqueued meanwhile wait for the next call.
+	bool process()
+	{
+		const size_t end = enqueuePosition.load(std::memory_order_acquire);
+		bool processed = false;
+		while(dequeuePosition.load(std::memory_order_relaxed) != end && processOne()) {
+			processed = true;
+		}
+		return processed;
+	}
+
+	bool processUpTo(size_t count)
+	{
+		size_t processed = 0;
+		while(processed < count && processOne()) {
+			++processed;
+		}
+		return processed > 0;
+	}
+
+	// Stops once duration has elapsed, checked after each event.
+	template <class Rep, class Period>
+	bool processFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + duration;
+		if(! processOne()) {
+			return false;
+		}
+		while(std::chrono::steady_clock::now() < deadline && processOne()) {
+		}
+		return true;
+	}
+
+	bool processOne()
+	{
+		const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		Cell & cell = cells[position & (capacity - 1)];
+		if(cell.sequence.load(std::memory_order_acquire) != position + 1) {
+			return false;
+		}
+
+		// The cell stays claimed while the listeners run, producers can't reuse it.
+		doDispatchQueuedEvent(
+			cell.item.get(),
+			typename MakeIndexSequence<sizeof...(Args)>::Type()
+		);
+		doRelease(cell, position);
+		return true;
+	}
+
+	void wait() const
+	{
+		if(doCanProcess()) {
+			return;
+		}
+		std::unique_lock<Mutex> lock(waitMutex);
+		consumerWaiting.store(true, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		waitConditionVariable.wait(lock, [this]() -> bool {
+			return doCanProcess();
+		});
+		consumerWaiting.store(false, std::memory_order_relaxed);
+	}
+
+	template <class Rep, class Period>
+	bool waitFor(const std::chrono::duration<Rep, Period> & duration) const
+	{
+		if(doCanProcess()) {
+			return true;
+		}
+		std::unique_lock<Mutex> lock(waitMutex);
+		consumerWaiting.store(true, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const bool result = waitConditionVariable.wait_for(lock, duration, [this]() -> bool {
+			return doCanProcess();
+		});
+		consumerWaiting.store(false, std::memory_order_relaxed);
+		return result;
+	}
+
+	using super::dispatch;
+
+	template <typename U>
+	auto dispatch(const U & queuedEvent)
+		-> typename std::enable_if<std::is_same<U, QueuedEvent>::value, void>::type
+	{
+		doDispatchQueuedEvent(
+			queuedEvent,
+			typename MakeIndexSequence<sizeof...(Args)>::Type()
+		);
+	}
+
+	bool peekEvent(QueuedEvent * queuedEvent)
+	{
+		const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		const Cell & cell = cells[position & (capacity - 1)];
+		if(cell.sequence.load(std::memory_order_acquire) != position + 1) {
+			return false;
+		}
+		*queuedEvent = cell.item.get();
+		return true;
+	}
+
+	bool takeEvent(QueuedEvent * queuedEvent)
+	{
+		return doTake(queuedEvent);
+	}
+
+	// enqueue() calls that found the ring full and had to yield.
+	size_t getFullWaitCount() const
+	{
+		return fullWaitCount.load(std::memory_order_relaxed);
+	}
+
+	static constexpr size_t getCapacity()
+	{
+		return capacity;
+	}
+
+protected:
+	bool doCanProcess() const
+	{
+		const size_t position = dequeuePosition.load(std::memory_order_acquire);
+		return cells[position & (capacity - 1)].sequence.load(std::memory_order_acquire) == position + 1;
+	}
+
+	template <typename T, size_t ...Indexes>
+	void doDispatchQueuedEvent(T && item, IndexSequence<Indexes...>)
+	{
+		this->directDispatch(item.event, std::get<Indexes>(item.arguments)...);
+	}
+
+	void doEnqueue(QueuedEvent && item)
+	{
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		Cell * cell;
+		bool waited = false;
+		for(;;) {
+			cell = &cells[position & (capacity - 1)];
+			const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			const intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+			if(difference == 0) {
+				if(enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if(difference < 0) {
+				// Full: the consumer has not released the cell one lap behind yet.
+				if(! waited) {
+					waited = true;
+					fullWaitCount.fetch_add(1, std::memory_order_relaxed);
+				}
+				std::this_thread::yield();
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+			else {
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->item.set(std::move(item));
+		cell->sequence.store(position + 1, std::memory_order_release);
+
+		// Pairs with the fence after consumerWaiting is set: either the consumer sees the
+		// published cell before sleeping or this thread sees that it sleeps.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(consumerWaiting.load(std::memory_order_relaxed)) {
+			std::lock_guard<Mutex> lock(waitMutex);
+			waitConditionVariable.notify_one();
+		}
+	}
+
+	bool doTake(QueuedEvent * queuedEvent)
+	{
+		const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		Cell & cell = cells[position & (capacity - 1)];
+		if(cell.sequence.load(std::memory_order_acquire) != position + 1) {
+			return false;
+		}
+		*queuedEvent = std::move(cell.item.get());
+		doRelease(cell, position);
+		return true;
+	}
+
+	void doRelease(Cell & cell, size_t position)
+	{
+		cell.item.clear();
+		cell.sequence.store(position + capacity, std::memory_order_release);
+		dequeuePosition.store(position + 1, std::memory_order_release);
+	}
+
+private:
+	std::unique_ptr<Cell[]> cells;
+	alignas(64) std::atomic<size_t> enqueuePosition;
+	alignas(64) std::atomic<size_t> dequeuePosition;
+	mutable std::atomic<bool> consumerWaiting;
+	std::atomic<size_t> fullWaitCount;
+	mutable Mutex waitMutex;
+	mutable ConditionVariable waitConditionVariable;
+};
+
+} //namespace internal_
+
+} //namespace eventpp
+
+#endif
@@ -0,0 +1,433 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VECTORCALLBACKLIST_I_H
+#define VECTORCALLBACKLIST_I_H
+
+// Don't include this header, include callbacklist.h and use the CallbackVector policy instead
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace eventpp {
+
+namespace internal_ {
+
+// CallbackList storage for the CallbackVector policy.
+// The callbacks live in one vector which is walked by index, no node is reference counted.
+// A published vector is never changed: append/prepend/insert/remove build the next one
+// under the mutex and publish it, so a change takes effect at once however the dispatches
+// overlap. A dispatch takes no lock: it counts itself in the current epoch and walks the
+// vector published then. Each change moves to the next epoch once the dispatches of the
+// epoch before the current one are done, and frees the replaced vectors no running
+// dispatch can still walk. remove() also marks the entry removed in those vectors (a
+// tombstone), so a removed callback isn't invoked again. A callback added during a
+// dispatch is invoked from the next dispatch on.
+template <
+	typename Prototype,
+	typename PoliciesType
+>
+class VectorCallbackListBase;
+
+template <
+	typename PoliciesType,
+	typename ReturnType, typename ...Args
+>
+class VectorCallbackListBase<
+	ReturnType (Args...),
+	PoliciesType
+>
+{
+private:
+	using Policies = PoliciesType;
+
+	using Threading = typename SelectThreading<Policies, HasTypeThreading<Policies>::value>::Type;
+
+	using Callback_ = typename SelectCallback<
+		Policies,
+		HasTypeCallback<Policies>::value,
+		std::function<ReturnType (Args...)>
+	>::Type;
+
+	using CanContinueInvoking = typename SelectCanContinueInvoking<
+		Policies, HasFunctionCanContinueInvoking<Policies, Args...>::value
+	>::Type;
+
+	using Id = uint64_t;
+
+	struct Entry
+	{
+		Entry(const Callback_ & callback, const Id id)
+			: callback(callback), id(id), removed(false)
+		{
+		}
+
+		Entry(const Entry & other)
+			: callback(other.callback), id(other.id), removed(other.removed.load(std::memory_order_relaxed))
+		{
+		}
+
+		Entry(Entry && other) noexcept
+			: callback(std::move(other.callback)), id(other.id), removed(other.removed.load(std::memory_order_relaxed))
+		{
+		}
+
+		Entry & operator = (Entry && other) noexcept {
+			callback = std::move(other.callback);
+			id = other.id;
+			removed.store(other.removed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return *this;
+		}
+
+		Callback_ callback;
+		Id id;
+		typename Threading::template Atomic<bool> removed;
+	};
+
+	using Entries = std::vector<Entry>;
+
+	// A replaced vector, kept while dispatches may still walk it.
+	struct Retired
+	{
+		std::unique_ptr<Entries> entries;
+		// The epoch it was replaced in.
+		size_t epoch;
+	};
+
+	class Handle_
+	{
+	public:
+		Handle_() noexcept : id(0) {
+		}
+
+		// True for a handle returned by the list, even after the callback is removed.
+		operator bool () const noexcept {
+			return id != 0;
+		}
+
+	private:
+		explicit Handle_(const Id id) noexcept : id(id) {
+		}
+
+		Id id;
+
+		friend class VectorCallbackListBase;
+	};
+
+public:
+	using Callback = Callback_;
+	using Handle = Handle_;
+	using Mutex = typename Threading::Mutex;
+
+public:
+	VectorCallbackListBase() noexcept
+		:
+			entries(nullptr),
+			retired(),
+			epoch(0),
+			mutex(),
+			nextId(0)
+	{
+		readers[0].store(0);
+		readers[1].store(0);
+	}
+
+	VectorCallbackListBase(const VectorCallbackListBase & other)
+		: VectorCallbackListBase()
+	{
+		std::lock_guard<Mutex> lockGuard(other.mutex);
+		const Entries * const current = other.entries.load(std::memory_order_acquire);
+		if(current != nullptr) {
+			// New entries, so a removal from one list doesn't mark the other.
+			std::unique_ptr<Entries> copied(new Entries());
+			copied->reserve(current->size());
+			for(const Entry & entry : *current) {
+				copied->push_back(Entry(entry.callback, entry.id));
+			}
+			entries.store(copied.release());
+		}
+		nextId = other.nextId;
+	}
+
+	VectorCallbackListBase(VectorCallbackListBase && other) noexcept
+		: VectorCallbackListBase()
+	{
+		swap(other);
+	}
+
+	~VectorCallbackListBase()
+	{
+		delete entries.load(std::memory_order_acquire);
+	}
+
+	VectorCallbackListBase & operator = (const VectorCallbackListBase & other) {
+		if(this != &other) {
+			VectorCallbackListBase copied(other);
+			swap(copied);
+		}
+		return *this;
+	}
+
+	VectorCallbackListBase & operator = (VectorCallbackListBase && other) noexcept {
+		if(this != &other) {
+			swap(other);
+		}
+		return *this;
+	}
+
+	// As with the linked list, no dispatch may run on either list meanwhile.
+	void swap(VectorCallbackListBase & other) noexcept {
+		using std::swap;
+
+		Entries * const mine = entries.load(std::memory_order_relaxed);
+		entries.store(other.entries.load(std::memory_order_relaxed));
+		other.entries.store(mine);
+		const size_t myEpoch = epoch.load(std::memory_order_relaxed);
+		epoch.store(other.epoch.load(std::memory_order_relaxed));
+		other.epoch.store(myEpoch);
+		swap(retired, other.retired);
+		swap(nextId, other.nextId);
+	}
+
+	bool empty() const {
+		// The current vector is only freed by a change, with the mutex locked.
+		std::lock_guard<Mutex> lockGuard(mutex);
+		const Entries * const current = entries.load(std::memory_order_acquire);
+		return current == nullptr || current->empty();
+	}
+
+	operator bool() const {
+		return ! empty();
+	}
+
+	Handle append(const Callback & callback)
+	{
+		std::lock_guard<Mutex> lockGuard(mutex);
+		return doInsert(callback, 0, false);
+	}
+
+	Handle prepend(const Callback & callback)
+	{
+		std::lock_guard<Mutex> lockGuard(mutex);
+		return doInsert(callback, 0, true);
+	}
+
+	Handle insert(const Callback & callback, const Handle & before)
+	{
+		std::lock_guard<Mutex> lockGuard(mutex);
+		return doInsert(callback, before.id, false);
+	}
+
+	bool remove(const Handle & handle)
+	{
+		if(! handle) {
+			return false;
+		}
+
+		std::lock_guard<Mutex> lockGuard(mutex);
+
+		Entries * const current = entries.load(std::memory_order_relaxed);
+		if(current == nullptr) {
+			return false;
+		}
+		auto it = doFind(*current, handle.id);
+		if(it == current->end()) {
+			return false;
+		}
+
+		// The dispatches walking this vector or a retired one skip the entry from now on.
+		it->removed.store(true, std::memory_order_release);
+		for(Retired & item : retired) {
+			auto retiredIt = doFind(*item.entries, handle.id);
+			if(retiredIt != item.entries->end()) {
+				retiredIt->removed.store(true, std::memory_order_release);
+			}
+		}
+
+		std::unique_ptr<Entries> next(new Entries());
+		next->reserve(current->size() - 1);
+		for(const Entry & entry : *current) {
+			if(entry.id != handle.id) {
+				next->push_back(entry);
+			}
+		}
+		doPublish(std::move(next));
+		return true;
+	}
+
+	template <typename Func>
+	void forEach(Func && func) const
+	{
+		doForEachIf([&func, this](Entry & entry) -> bool {
+			doForEachInvoke<void>(func, entry);
+			return true;
+		});
+	}
+
+	template <typename Func>
+	bool forEachIf(Func && func) const
+	{
+		return doForEachIf([&func, this](Entry & entry) -> bool {
+			return doForEachInvoke<bool>(func, entry);
+		});
+	}
+
+	void operator() (Args ...args) const
+	{
+		// Don't std::forward, see CallbackListBase::operator().
+		forEachIf([&args...](Callback & callback) -> bool {
+			callback(args...);
+			return CanContinueInvoking::canContinueInvoking(args...);
+		});
+	}
+
+private:
+	struct EpochGuard
+	{
+		explicit EpochGuard(const VectorCallbackListBase * list) : list(list), pinned(list->doPin()) {
+		}
+
+		~EpochGuard() {
+			--list->readers[pinned & 1];
+		}
+
+		const VectorCallbackListBase * list;
+		size_t pinned;
+	};
+
+	template <typename F>
+	bool doForEachIf(F && f) const
+	{
+		EpochGuard guard(this);
+
+		// Published after the pin, so the vector outlives the guard.
+		Entries * const snapshot = entries.load();
+		if(snapshot == nullptr) {
+			return true;
+		}
+		for(Entry & entry : *snapshot) {
+			if(! entry.removed.load(std::memory_order_acquire)) {
+				if(! f(entry)) {
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Counts a dispatch in the current epoch. The seq_cst counter and loads pair with
+	// doPublish(): either the change sees the dispatch counted or the dispatch sees the
+	// new epoch and vector.
+	size_t doPin() const
+	{
+		for(;;) {
+			const size_t pinned = epoch.load();
+			++readers[pinned & 1];
+			if(epoch.load() == pinned) {
+				return pinned;
+			}
+			--readers[pinned & 1];
+		}
+	}
+
+	template <typename RT, typename Func>
+	auto doForEachInvoke(Func && func, Entry & entry) const
+		-> typename std::enable_if<CanInvoke<Func, Handle, Callback &>::value, RT>::type
+	{
+		return func(Handle(entry.id), entry.callback);
+	}
+
+	template <typename RT, typename Func>
+	auto doForEachInvoke(Func && func, Entry & entry) const
+		-> typename std::enable_if<CanInvoke<Func, Callback &>::value, RT>::type
+	{
+		return func(entry.callback);
+	}
+
+	// Called with the mutex locked.
+	Handle doInsert(const Callback & callback, const Id before, const bool front)
+	{
+		const Id id = ++nextId;
+		const Entries * const current = entries.load(std::memory_order_relaxed);
+		std::unique_ptr<Entries> next(new Entries());
+		if(current != nullptr) {
+			next->reserve(current->size() + 1);
+			for(const Entry & entry : *current) {
+				next->push_back(entry);
+			}
+		}
+		// An unknown before appends, as CallbackListBase does for an expired handle.
+		auto it = front ? next->begin() : (before != 0 ? doFind(*next, before) : next->end());
+		next->insert(it, Entry(callback, id));
+		doPublish(std::move(next));
+		return Handle(id);
+	}
+
+	// Called with the mutex locked. Replaces the current vector, then moves on by up to
+	// two epochs: to the next one once no dispatch of the epoch before the current one is
+	// left. A vector replaced in epoch E can only be walked by dispatches of E and E - 1,
+	// so it is freed once the epoch reaches E + 2.
+	void doPublish(std::unique_ptr<Entries> next)
+	{
+		Entries * const previous = entries.load(std::memory_order_relaxed);
+		entries.store(next.release());
+		if(previous != nullptr) {
+			retired.push_back(Retired{ std::unique_ptr<Entries>(previous), epoch.load(std::memory_order_relaxed) });
+		}
+		for(int i = 0; i < 2; ++i) {
+			const size_t current = epoch.load(std::memory_order_relaxed);
+			if(readers[(current + 1) & 1].load() != 0) {
+				break;
+			}
+			epoch.store(current + 1);
+		}
+		const size_t current = epoch.load(std::memory_order_relaxed);
+		retired.erase(
+			std::remove_if(retired.begin(), retired.end(), [current](const Retired & item) -> bool {
+				return item.epoch + 2 <= current;
+			}),
+			retired.end()
+		);
+	}
+
+	static typename Entries::iterator doFind(Entries & in, const Id id)
+	{
+		return std::find_if(in.begin(), in.end(), [id](const Entry & entry) -> bool {
+			return entry.id == id && ! entry.removed.load(std::memory_order_relaxed);
+		});
+	}
+
+private:
+	// The current vector, null until the first insert. Never changed once published.
+	typename Threading::template Atomic<Entries *> entries;
+	// Replaced vectors a dispatch may still walk, freed by a later change or the destructor.
+	std::vector<Retired> retired;
+	typename Threading::template Atomic<size_t> epoch;
+	// Running dispatches counted in an even and an odd epoch.
+	mutable typename Threading::template Atomic<size_t> readers[2];
+	mutable Mutex mutex;
+	Id nextId;
+};
+
+
+} //namespace internal_
+
+} //namespace eventpp
+
+#endif
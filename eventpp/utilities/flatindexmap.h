@@ -0,0 +1,216 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FLATINDEXMAP_H_402817735109
+#define FLATINDEXMAP_H_402817735109
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eventpp {
+
+// A map for small non-negative integral or enum keys, usable as the Map policy:
+//   template <typename Key, typename T> using Map = FlatIndexMap<Key, T, 16>;
+// The key is the index of its slot, so find() is a bounds check and an array access.
+// With Capacity > 0 the keys 0..Capacity-1 live in a fixed array inside the map.
+// With Capacity == 0 the slots are allocated on demand, BlockSize at a time, up to
+// MaxIndex. Other keys (negative or too large) fall back to a std::map.
+// A value never moves once created, EventDispatcher uses it after unlocking the map.
+template <typename Key, typename T, std::size_t Capacity = 0>
+class FlatIndexMap
+{
+private:
+	static_assert(std::is_integral<Key>::value || std::is_enum<Key>::value,
+		"FlatIndexMap requires an integral or enum key.");
+
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	// Pointers to the entry, the end iterator is nullptr.
+	using iterator = value_type *;
+	using const_iterator = const value_type *;
+
+	enum : std::size_t {
+		BlockSize = 64,
+		MaxIndex = Capacity > 0 ? Capacity : 64 * 1024
+	};
+
+private:
+	struct Slot
+	{
+		Slot() : entry(), used(false) {
+		}
+
+		value_type entry;
+		bool used;
+	};
+
+	using Block = std::array<Slot, BlockSize>;
+
+public:
+	FlatIndexMap()
+		: slots(), blocks(), others(), count(0)
+	{
+	}
+
+	FlatIndexMap(const FlatIndexMap & other)
+		: slots(other.slots), blocks(), others(other.others), count(other.count)
+	{
+		blocks.reserve(other.blocks.size());
+		for(const auto & block : other.blocks) {
+			blocks.emplace_back(block ? new Block(*block) : nullptr);
+		}
+	}
+
+	FlatIndexMap(FlatIndexMap && other) noexcept
+		: FlatIndexMap()
+	{
+		swap(other);
+	}
+
+	FlatIndexMap & operator = (const FlatIndexMap & other) {
+		if(this != &other) {
+			FlatIndexMap copied(other);
+			swap(copied);
+		}
+		return *this;
+	}
+
+	FlatIndexMap & operator = (FlatIndexMap && other) noexcept {
+		if(this != &other) {
+			swap(other);
+		}
+		return *this;
+	}
+
+	void swap(FlatIndexMap & other) noexcept {
+		using std::swap;
+
+		swap(slots, other.slots);
+		swap(blocks, other.blocks);
+		swap(others, other.others);
+		swap(count, other.count);
+	}
+
+	friend void swap(FlatIndexMap & a, FlatIndexMap & b) noexcept {
+		a.swap(b);
+	}
+
+	T & operator [] (const Key & key) {
+		Slot * slot = doGetSlot(key);
+		if(slot == nullptr) {
+			auto it = others.find(key);
+			if(it == others.end()) {
+				it = others.emplace(key, value_type(key, T())).first;
+				++count;
+			}
+			return it->second.second;
+		}
+		if(! slot->used) {
+			slot->entry.first = key;
+			slot->used = true;
+			++count;
+		}
+		return slot->entry.second;
+	}
+
+	iterator find(const Key & key) {
+		return const_cast<iterator>(static_cast<const FlatIndexMap *>(this)->find(key));
+	}
+
+	const_iterator find(const Key & key) const {
+		const std::size_t index = doIndexOf(key);
+		if(index < MaxIndex) {
+			const Slot * slot = doFindSlot(index);
+			return slot != nullptr && slot->used ? &slot->entry : nullptr;
+		}
+		auto it = others.find(key);
+		return it != others.end() ? &it->second : nullptr;
+	}
+
+	iterator end() noexcept {
+		return nullptr;
+	}
+
+	const_iterator end() const noexcept {
+		return nullptr;
+	}
+
+	std::size_t size() const noexcept {
+		return count;
+	}
+
+	bool empty() const noexcept {
+		return count == 0;
+	}
+
+private:
+	// MaxIndex for the keys kept in others.
+	static std::size_t doIndexOf(const Key & key) {
+		const long long value = static_cast<long long>(key);
+		if(value < 0 || static_cast<unsigned long long>(value) >= MaxIndex) {
+			return MaxIndex;
+		}
+		return static_cast<std::size_t>(value);
+	}
+
+	// nullptr if the block of index isn't allocated yet.
+	const Slot * doFindSlot(const std::size_t index) const {
+		if(Capacity > 0) {
+			return &slots[index];
+		}
+		const std::size_t blockIndex = index / BlockSize;
+		if(blockIndex >= blocks.size() || ! blocks[blockIndex]) {
+			return nullptr;
+		}
+		return &(*blocks[blockIndex])[index % BlockSize];
+	}
+
+	// nullptr for the keys kept in others.
+	Slot * doGetSlot(const Key & key) {
+		const std::size_t index = doIndexOf(key);
+		if(index >= MaxIndex) {
+			return nullptr;
+		}
+		if(Capacity > 0) {
+			return &slots[index];
+		}
+		const std::size_t blockIndex = index / BlockSize;
+		if(blockIndex >= blocks.size()) {
+			blocks.resize(blockIndex + 1);
+		}
+		if(! blocks[blockIndex]) {
+			blocks[blockIndex].reset(new Block());
+		}
+		return &(*blocks[blockIndex])[index % BlockSize];
+	}
+
+private:
+	std::array<Slot, Capacity> slots;
+	// Only used when Capacity is 0. Blocks are never freed, so the values don't move.
+	std::vector<std::unique_ptr<Block> > blocks;
+	std::map<Key, value_type> others;
+	std::size_t count;
+};
+
+
+} //namespace eventpp
+
+#endif
+
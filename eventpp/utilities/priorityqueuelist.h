@@ -0,0 +1,222 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PRIORITYQUEUELIST_H_417302958164
+#define PRIORITYQUEUELIST_H_417302958164
+
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <utility>
+
+namespace eventpp {
+
+// Returns the priority of a queued event, higher priorities are dispatched first.
+struct PriorityQueueListGetPriority
+{
+	template <typename T>
+	int operator() (const T & queuedEvent) const {
+		return static_cast<int>(queuedEvent.event);
+	}
+};
+
+// Coalescing policy of PriorityQueueList. key() returns the coalescing key of a queued
+// event, 0 when the event must be dispatched on its own. merge() folds incoming into the
+// pending event with the same key and priority; incoming is discarded afterwards.
+struct PriorityQueueListNoCoalesce
+{
+	template <typename T>
+	int key(const T & /*queuedEvent*/) const {
+		return 0;
+	}
+
+	template <typename T>
+	void merge(T & pending, T & incoming) const {
+		pending = std::move(incoming);
+	}
+};
+
+// QueueList policy ordering events by an integer priority, FIFO within a priority.
+// Unlike OrderedQueueList, which sorts the whole list on every splice, the events
+// of one priority form a contiguous bucket and the tail of each bucket is kept in a
+// map, so inserting an event costs O(log buckets). Nodes are moved with
+// std::list::splice only, so the EventQueue free list keeps recycling them.
+// Empty (recycled) items are kept in front of the buckets, unordered.
+// With a Coalesce policy, an event whose key matches a pending event of the same
+// priority is merged into it in O(1); its node stays, empty, in the source list of
+// the splice, where EventQueue recycles it.
+template <typename T, typename GetPriority = PriorityQueueListGetPriority, typename Coalesce = PriorityQueueListNoCoalesce>
+class PriorityQueueList
+{
+private:
+	struct Node : public T
+	{
+		int priority;
+		int key;
+		bool inBucket;
+
+		Node() : T(), priority(0), key(0), inBucket(false) {
+		}
+	};
+
+	using NodeList = std::list<Node>;
+	using BucketMap = std::map<int, typename NodeList::iterator, std::greater<int> >;
+	using PendingMap = std::unordered_map<int, typename NodeList::iterator>;
+
+public:
+	using iterator = typename NodeList::iterator;
+	using const_iterator = typename NodeList::const_iterator;
+
+	PriorityQueueList() = default;
+	PriorityQueueList(PriorityQueueList && other) = default;
+	PriorityQueueList & operator = (PriorityQueueList && other) = default;
+
+	bool empty() const {
+		return nodes.empty();
+	}
+
+	iterator begin() {
+		return nodes.begin();
+	}
+
+	iterator end() {
+		return nodes.end();
+	}
+
+	const_iterator begin() const {
+		return nodes.begin();
+	}
+
+	const_iterator end() const {
+		return nodes.end();
+	}
+
+	T & front() {
+		return nodes.front();
+	}
+
+	const T & front() const {
+		return nodes.front();
+	}
+
+	void swap(PriorityQueueList & other) {
+		nodes.swap(other.nodes);
+		buckets.swap(other.buckets);
+		pending.swap(other.pending);
+	}
+
+	void emplace_back() {
+		nodes.emplace_front();
+	}
+
+	// pos is ignored, the items go to their priority bucket.
+	void splice(const_iterator /*pos*/, PriorityQueueList & other) {
+		for(auto it = other.nodes.begin(); it != other.nodes.end(); ) {
+			const auto next = std::next(it);
+			doInsert(other, it);
+			it = next;
+		}
+	}
+
+	void splice(const_iterator /*pos*/, PriorityQueueList & other, const_iterator it) {
+		doInsert(other, other.nodes.erase(it, it));
+	}
+
+private:
+	// Detach it from other's buckets and move it to its place in this list.
+	void doInsert(PriorityQueueList & other, iterator it) {
+		other.doUnlink(it);
+
+		Node & node = *it;
+		if(node.empty()) {
+			nodes.splice(nodes.begin(), other.nodes, it);
+			return;
+		}
+
+		node.priority = GetPriority()(node.get());
+		node.key = Coalesce().key(node.get());
+		if(node.key != 0) {
+			auto found = pending.find(node.key);
+			if(found != pending.end() && found->second->priority == node.priority) {
+				Coalesce().merge(found->second->get(), node.get());
+				node.clear();
+				other.nodes.splice(other.nodes.begin(), other.nodes, it);
+				return;
+			}
+			pending[node.key] = it;
+		}
+
+		node.inBucket = true;
+		auto bucket = buckets.find(node.priority);
+		if(bucket != buckets.end()) {
+			nodes.splice(std::next(bucket->second), other.nodes, it);
+			bucket->second = it;
+			return;
+		}
+
+		// New bucket: right after the tail of the nearest higher priority,
+		// or after the empty items when there is none.
+		bucket = buckets.lower_bound(node.priority);
+		iterator pos;
+		if(bucket != buckets.begin()) {
+			pos = std::next(std::prev(bucket)->second);
+		}
+		else {
+			pos = nodes.begin();
+			while(pos != nodes.end() && ! pos->inBucket) {
+				++pos;
+			}
+		}
+		nodes.splice(pos, other.nodes, it);
+		buckets.emplace(node.priority, it);
+	}
+
+	// Called before it leaves this list. The cached priority is used because
+	// the item may have been cleared meanwhile.
+	void doUnlink(iterator it) {
+		if(! it->inBucket) {
+			return;
+		}
+		it->inBucket = false;
+		if(it->key != 0) {
+			auto found = pending.find(it->key);
+			if(found != pending.end() && found->second == it) {
+				pending.erase(found);
+			}
+		}
+		auto bucket = buckets.find(it->priority);
+		if(bucket == buckets.end() || bucket->second != it) {
+			return;
+		}
+		if(it != nodes.begin()) {
+			auto prev = std::prev(it);
+			if(prev->inBucket && prev->priority == it->priority) {
+				bucket->second = prev;
+				return;
+			}
+		}
+		buckets.erase(bucket);
+	}
+
+private:
+	NodeList nodes;
+	BucketMap buckets;
+	PendingMap pending;
+};
+
+
+} //namespace eventpp
+
+#endif
+
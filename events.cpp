@@ -1,16 +1,94 @@
 #include "events.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "constants.h"
+#include "eventpp/hetereventqueue.h"
+
+namespace
+{
+    // The events loop and the dispatch workers: a full bound never makes
+    // them wait, they would wait for themselves.
+    thread_local bool isDispatchThread = false;
+    // Channel of Events::PostToGui() the thread owns, -1 for the shared one.
+    thread_local const Events* guiChannelOwner = nullptr;
+    thread_local int guiChannel = -1;
+}
+
+GuiUpdate::GuiUpdate(int kind, int code, const char* text)
+{
+    this->kind = kind;
+    this->code = code;
+    size_t length = strlen(text);
+    if (length >= sizeof(this->text))
+    {
+        length = sizeof(this->text) - 1;
+        // Don't end in the middle of a UTF-8 sequence.
+        while (length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80)
+        {
+            --length;
+        }
+    }
+    memcpy(this->text, text, length);
+    this->text[length] = 0;
+}
 
 // -----------------------------
 //
 // -----------------------------
 Events::Events()
+    : latency((const char*)u8" ", "Event enqueue-to-dispatch latency"),
+      timerLateness((const char*)u8" ", "Timer deadline-to-fire lateness"),
+      bridge(*this),
+      shardLatency((const char*)u8"  ", "Shard enqueue-to-dispatch latency")
 {
     spdlog::info(u8"Events contructor.");
     isEventsLoopRunning = false;
     eventsLoopThread = nullptr;
     spdlog::info(u8"Events class constructor.");
     needStop = false;
+    loopWaitUntil = std::chrono::steady_clock::time_point::max();
+    dataPollTimer = 0;
+    boundWaiters = 0;
+    guiChannels.reset(new GuiChannel[GUI_CHANNELS]);
+    guiTakeStart = 0;
+    guiWakePending = false;
+    guiDropped = 0;
+    for (QueueBound& bound : bounds)
+    {
+        bound.capacity = 0;
+        bound.overflow = constants::QUEUE_OVERFLOW_DROP_NEWEST;
+        bound.pending = 0;
+        bound.highWater = 0;
+        bound.dropped = 0;
+        bound.blocked = 0;
+        bound.coalesced = 0;
+    }
+    SetQueueBound(constants::EVENT_TYPE_GUI, constants::EVENT_QUEUE_CAPACITY_GUI, constants::QUEUE_OVERFLOW_BLOCK);
+    SetQueueBound(constants::EVENT_TYPE_DATA_POLL, constants::EVENT_QUEUE_CAPACITY_DATA_POLL, constants::QUEUE_OVERFLOW_COALESCE);
+    queue.appendFilter([this](const MyEvent& event) -> bool
+    {
+        release(event.boundType, event.admitted);
+        if (event.enqueueTime != std::chrono::steady_clock::time_point())
+        {
+            latency.Record(event.e, std::chrono::steady_clock::now() - event.enqueueTime);
+        }
+        if (event.merged != 0)
+        {
+            latency.RecordMerged(event.e, event.merged);
+        }
+        return true;
+    });
+    // Every command reports back to the status bar.
+    queue.appendListener(constants::EVENT_TYPE_GUI, [this](const MyEvent& event)
+    {
+        PostToGui(GuiUpdate(constants::GUI_UPDATE_STATUS, event.e, EventLatency::CodeName(event.e)));
+    });
 }
 // -----------------------------
 //
@@ -25,12 +103,37 @@ Events::~Events()
 void Events::eventsLoop(void)
 {
     isEventsLoopRunning = true;
+    isDispatchThread = true;
+    guiChannelOwner = this;
+    guiChannel = 0;
     spdlog::info(u8"  eventsLoop.");
     while (!needStop)
     {
-        //queue.wait();
-        queue.process();
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        // Sleeps until an event is queued or the next timer is due; Stop()
+        // and earlier new timers queue a wakeup event.
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration timeout = std::chrono::milliseconds(constants::EVENTS_WAIT_TIMEOUT_MS);
+        {
+            std::lock_guard<std::mutex> lock(timersMutex);
+            std::chrono::steady_clock::time_point wakeup = timers.NextWakeup();
+            if (wakeup - now < timeout)
+            {
+                timeout = wakeup > now ? wakeup - now : std::chrono::steady_clock::duration::zero();
+            }
+            loopWaitUntil = now + timeout;
+        }
+        queue.waitFor(timeout);
+        {
+            std::lock_guard<std::mutex> lock(timersMutex);
+            loopWaitUntil = std::chrono::steady_clock::time_point::max();
+            now = std::chrono::steady_clock::now();
+            timers.Advance(now, [this, now](const TimerEvent& timer, std::chrono::steady_clock::time_point deadline)
+            {
+                timerLateness.Record(timer.event.e, now - deadline);
+                Enqueue(timer.type, timer.event);
+            });
+        }
+        queue.processFor(std::chrono::microseconds(constants::EVENTS_DISPATCH_SLICE_US));
     }
     spdlog::info(u8"    .");    
     isEventsLoopRunning = false;
@@ -38,19 +141,85 @@ void Events::eventsLoop(void)
 // -----------------------------
 // 
 // -----------------------------
-void Events::Run(void)
+void Events::Run(int workers)
 {
     spdlog::info(u8"Environment loop starting.");
-    eventsLoopThread = new std::thread(&Events::eventsLoop, this);
-    isEventsLoopRunning = true;
     needStop = false;
+    isEventsLoopRunning = true;
+    shards.clear();
+    shardLatency.Reset();
+    workers = std::min(workers, constants::MAX_EVENT_WORKERS);
+    for (int i = 0; i < workers; ++i)
+    {
+        shards.emplace_back(new Shard());
+        shards.back()->enqueued = 0;
+        shards.back()->dispatched = 0;
+        shards.back()->merged = 0;
+        shards.back()->discarded = 0;
+        shards.back()->maxDepth = 0;
+    }
+    for (int i = 0; i < workers; ++i)
+    {
+        shards[i]->thread = std::thread(&Events::shardLoop, this, i);
+    }
+    eventsLoopThread = new std::thread(&Events::eventsLoop, this);
+    MyEvent poll(constants::EVENT_CODE_DATA_POLL, 0);
+    poll.orderingKey = constants::ORDER_KEY_DEVICE;
+    dataPollTimer = ScheduleEvery(std::chrono::milliseconds(constants::DATA_DELAY_MS),
+        constants::EVENT_TYPE_DATA_POLL, poll);
+}
+// -----------------------------
+// 
+// -----------------------------
+void Events::shardLoop(int index)
+{
+    isDispatchThread = true;
+    guiChannelOwner = this;
+    guiChannel = 1 + index;
+    Shard& shard = *shards[index];
+    EQ::QueuedEvent item{ 0, std::make_tuple(MyEvent(constants::GUI_COMMAND_NONE, 0)) };
+    while (!needStop)
+    {
+        shard.queue.waitFor(std::chrono::milliseconds(constants::EVENTS_WAIT_TIMEOUT_MS));
+        while (!needStop && shard.queue.takeEvent(&item))
+        {
+            const MyEvent& event = std::get<0>(item.arguments);
+            if (event.enqueueTime != std::chrono::steady_clock::time_point())
+            {
+                shardLatency.Record(index, std::chrono::steady_clock::now() - event.enqueueTime);
+            }
+            queue.dispatch(item);
+            shard.merged.fetch_add((uint64_t)event.merged, std::memory_order_relaxed);
+            shard.dispatched.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
 }
 // -----------------------------
 // 
 // -----------------------------
 void Events::Stop(void)
 {
+    // No more commands from the bridge clients.
+    bridge.Stop();
+    CancelTimer(dataPollTimer);
+    dataPollTimer = 0;
     needStop = true;
+    {
+        std::lock_guard<std::mutex> lock(boundMutex);
+        boundFreed.notify_all();
+    }
+    queue.enqueue(constants::EVENT_TYPE_WAKEUP, MyEvent(constants::GUI_COMMAND_NONE, 0));
+    for (std::unique_ptr<Shard>& shard : shards)
+    {
+        shard->queue.enqueue(constants::EVENT_TYPE_WAKEUP, MyEvent(constants::GUI_COMMAND_NONE, 0));
+    }
+    for (std::unique_ptr<Shard>& shard : shards)
+    {
+        if (shard->thread.joinable())
+        {
+            shard->thread.join();
+        }
+    }
     if (eventsLoopThread != nullptr)
     {
         if (eventsLoopThread->joinable())
@@ -61,4 +230,1124 @@ void Events::Stop(void)
         delete eventsLoopThread;
         eventsLoopThread = nullptr;
     }
-}
\ No newline at end of file
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::Enqueue(int type, MyEvent event)
+{
+    return enqueue(type, event, !isDispatchThread);
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::TryEnqueue(int type, MyEvent event)
+{
+    return enqueue(type, event, false);
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::enqueue(int type, MyEvent& event, bool mayWait)
+{
+    event.enqueueTime = std::chrono::steady_clock::now();
+    Shard* shard = nullptr;
+    if (!shards.empty())
+    {
+        unsigned key = (unsigned)(event.orderingKey != 0 ? event.orderingKey : type);
+        shard = shards[key % shards.size()].get();
+    }
+    EQ& target = shard != nullptr ? shard->queue : queue;
+    if (type >= 0 && type < constants::MAX_EVENT_TYPES && bounds[type].capacity > 0
+        && !applyBound(type, event, mayWait))
+    {
+        return false;
+    }
+    if (journal.IsOpen())
+    {
+        EventJournal::Record record = EventJournal::Record();
+        record.type = type;
+        record.code = event.e;
+        record.priority = event.priority;
+        record.coalesceKey = event.coalesceKey;
+        record.orderingKey = event.orderingKey;
+        journal.Append(record, event.enqueueTime);
+    }
+    target.enqueue(type, event);
+    if (shard == nullptr)
+    {
+        return true;
+    }
+    int depth = (int)(shard->enqueued.fetch_add(1, std::memory_order_relaxed) + 1 - shardRetired(*shard));
+    int maxDepth = shard->maxDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth && !shard->maxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+    {
+    }
+    return true;
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::applyBound(int type, MyEvent& event, bool mayWait)
+{
+    QueueBound& bound = bounds[type];
+    event.boundType = type;
+    event.admitted = 1;
+    if (admit(bound))
+    {
+        return true;
+    }
+    switch (bound.overflow.load())
+    {
+    case constants::QUEUE_OVERFLOW_BLOCK:
+        if (mayWait)
+        {
+            ++bound.blocked;
+            bool admitted = false;
+            std::unique_lock<std::mutex> lock(boundMutex);
+            ++boundWaiters;
+            boundFreed.wait_for(lock, std::chrono::milliseconds(constants::EVENT_BLOCK_TIMEOUT_MS), [&]()
+            {
+                admitted = !needStop && admit(bound);
+                return admitted || needStop;
+            });
+            --boundWaiters;
+            if (admitted)
+            {
+                return true;
+            }
+        }
+        break;
+    case constants::QUEUE_OVERFLOW_DROP_OLDEST:
+    {
+        // The bound counts the events of every shard, so its oldest one can
+        // wait in any of them. Overflow events don't hold a slot,
+        // discarding them frees nothing.
+        auto candidate = [type](const MyEvent& pending) -> bool
+        {
+            return pending.boundType == type && pending.admitted > 0;
+        };
+        for (;;)
+        {
+            EQ* oldestQueue = nullptr;
+            Shard* oldestShard = nullptr;
+            std::chrono::steady_clock::time_point oldestTime = std::chrono::steady_clock::time_point::max();
+            auto findOldest = [&](EQ& candidateQueue, Shard* owner)
+            {
+                candidateQueue.forEachQueued([&](const EQ::QueuedEvent& item)
+                {
+                    const MyEvent& pending = std::get<0>(item.arguments);
+                    if (candidate(pending) && pending.enqueueTime < oldestTime)
+                    {
+                        oldestQueue = &candidateQueue;
+                        oldestShard = owner;
+                        oldestTime = pending.enqueueTime;
+                    }
+                });
+            };
+            findOldest(queue, nullptr);
+            for (std::unique_ptr<Shard>& owner : shards)
+            {
+                findOldest(owner->queue, owner.get());
+            }
+            if (oldestQueue == nullptr)
+            {
+                break;
+            }
+            EQ::QueuedEvent oldest{ 0, std::make_tuple(MyEvent(constants::GUI_COMMAND_NONE, 0)) };
+            if (oldestQueue->discardOneIf([&](const EQ::QueuedEvent& item) -> bool
+                {
+                    const MyEvent& pending = std::get<0>(item.arguments);
+                    return candidate(pending) && pending.enqueueTime == oldestTime;
+                }, &oldest))
+            {
+                const MyEvent& discarded = std::get<0>(oldest.arguments);
+                bound.dropped += (uint64_t)discarded.admitted;
+                if (oldestShard != nullptr)
+                {
+                    oldestShard->discarded.fetch_add(1 + (uint64_t)discarded.merged, std::memory_order_relaxed);
+                }
+                release(type, discarded.admitted);
+            }
+            // Either discarded or dispatched meanwhile, a slot is free
+            // unless another producer took it.
+            if (admit(bound))
+            {
+                return true;
+            }
+        }
+        break;
+    }
+    case constants::QUEUE_OVERFLOW_COALESCE:
+        event.coalesceKey = constants::COALESCE_KEY_OVERFLOW + type;
+        event.admitted = 0;
+        ++bound.coalesced;
+        return true;
+    default:
+        break;
+    }
+    ++bound.dropped;
+    PostToGui(GuiUpdate(constants::GUI_UPDATE_ERROR, type, (const char*)u8"  ,  "));
+    return false;
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::PostToGui(const GuiUpdate& update)
+{
+    if (bridge.IsRunning())
+    {
+        bridge.Post(update);
+    }
+    bool posted;
+    if (guiChannelOwner == this)
+    {
+        posted = guiChannels[guiChannel].Push(update);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(guiSharedMutex);
+        posted = guiChannels[GUI_CHANNELS - 1].Push(update);
+    }
+    if (!posted)
+    {
+        guiDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (!guiWakePending.exchange(true))
+    {
+        std::lock_guard<std::mutex> lock(guiWakeupMutex);
+        if (guiWakeup)
+        {
+            guiWakeup();
+        }
+    }
+    return true;
+}
+// -----------------------------
+// 
+// -----------------------------
+int Events::TakeGuiUpdates(GuiUpdate* out, int max)
+{
+    // Synchronizes with the exchange of the posts, so their updates are
+    // visible; later posts wake the GUI again.
+    guiWakePending.exchange(false);
+    int taken = 0;
+    for (int i = 0; i < GUI_CHANNELS && taken < max; ++i)
+    {
+        GuiChannel& channel = guiChannels[(guiTakeStart + i) % GUI_CHANNELS];
+        while (taken < max && channel.Pop(out[taken]))
+        {
+            ++taken;
+        }
+    }
+    guiTakeStart = (guiTakeStart + 1) % GUI_CHANNELS;
+    return taken;
+}
+// -----------------------------
+// 
+// -----------------------------
+void Events::SetGuiWakeup(std::function<void()> wakeup)
+{
+    std::lock_guard<std::mutex> lock(guiWakeupMutex);
+    guiWakeup = wakeup;
+}
+// -----------------------------
+// 
+// -----------------------------
+uint64_t Events::GuiUpdatesDropped(void) const
+{
+    return guiDropped.load(std::memory_order_relaxed);
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::admit(QueueBound& bound)
+{
+    int pending = bound.pending.load();
+    do
+    {
+        if (pending >= bound.capacity.load())
+        {
+            return false;
+        }
+    } while (!bound.pending.compare_exchange_weak(pending, pending + 1));
+    int highWater = bound.highWater.load(std::memory_order_relaxed);
+    while (pending + 1 > highWater && !bound.highWater.compare_exchange_weak(highWater, pending + 1, std::memory_order_relaxed))
+    {
+    }
+    return true;
+}
+// -----------------------------
+// 
+// -----------------------------
+void Events::release(int type, int admitted)
+{
+    if (admitted == 0 || type < 0 || type >= constants::MAX_EVENT_TYPES)
+    {
+        return;
+    }
+    bounds[type].pending -= admitted;
+    // Pairs with the waiter count taken before the producer checks for room.
+    if (boundWaiters > 0)
+    {
+        std::lock_guard<std::mutex> lock(boundMutex);
+        boundFreed.notify_all();
+    }
+}
+// -----------------------------
+// 
+// -----------------------------
+void Events::SetQueueBound(int type, int capacity, int overflow)
+{
+    if (type < 0 || type >= constants::MAX_EVENT_TYPES)
+    {
+        return;
+    }
+    bounds[type].overflow = overflow;
+    bounds[type].capacity = std::max(capacity, 0);
+}
+// -----------------------------
+// 
+// -----------------------------
+Events::QueueBoundStats Events::GetQueueBoundStats(int type) const
+{
+    QueueBoundStats stats = QueueBoundStats();
+    if (type < 0 || type >= constants::MAX_EVENT_TYPES)
+    {
+        return stats;
+    }
+    const QueueBound& bound = bounds[type];
+    stats.capacity = bound.capacity.load(std::memory_order_relaxed);
+    stats.overflow = bound.overflow.load(std::memory_order_relaxed);
+    stats.pending = bound.pending.load(std::memory_order_relaxed);
+    stats.highWater = bound.highWater.load(std::memory_order_relaxed);
+    stats.dropped = bound.dropped.load(std::memory_order_relaxed);
+    stats.blocked = bound.blocked.load(std::memory_order_relaxed);
+    stats.coalesced = bound.coalesced.load(std::memory_order_relaxed);
+    return stats;
+}
+// -----------------------------
+// 
+// -----------------------------
+const char* Events::OverflowName(int overflow)
+{
+    switch (overflow)
+    {
+    case constants::QUEUE_OVERFLOW_BLOCK:
+        return "block";
+    case constants::QUEUE_OVERFLOW_DROP_OLDEST:
+        return "drop-oldest";
+    case constants::QUEUE_OVERFLOW_DROP_NEWEST:
+        return "drop-newest";
+    case constants::QUEUE_OVERFLOW_COALESCE:
+        return "coalesce";
+    default:
+        return "?";
+    }
+}
+// -----------------------------
+// 
+// -----------------------------
+void Events::PrintQueueBoundSummary(FILE* f) const
+{
+    fprintf(f, "Queue bounds per event type\n");
+    fprintf(f, "%-5s %8s %-12s %8s %10s %10s %10s %10s\n", "type", "capacity", "overflow", "pending", "high water",
+        "dropped", "blocked", "coalesced");
+    for (int type = 0; type < constants::MAX_EVENT_TYPES; ++type)
+    {
+        QueueBoundStats stats = GetQueueBoundStats(type);
+        if (stats.capacity == 0)
+        {
+            continue;
+        }
+        fprintf(f, "%-5d %8d %-12s %8d %10d %10llu %10llu %10llu\n", type, stats.capacity, OverflowName(stats.overflow),
+            stats.pending, stats.highWater, (unsigned long long)stats.dropped, (unsigned long long)stats.blocked,
+            (unsigned long long)stats.coalesced);
+    }
+}
+// -----------------------------
+// 
+// -----------------------------
+int Events::OrderingKey(int command)
+{
+    switch (command)
+    {
+    case constants::GUI_COMMAND_NEW:
+    case constants::GUI_COMMAND_OPEN:
+    case constants::GUI_COMMAND_SAVE:
+        return constants::ORDER_KEY_FILES;
+    default:
+        return constants::ORDER_KEY_DEVICE;
+    }
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::HasPendingEvents(void) const
+{
+    if (!queue.emptyQueue())
+    {
+        return true;
+    }
+    for (const std::unique_ptr<Shard>& shard : shards)
+    {
+        if (!shard->queue.emptyQueue())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+// -----------------------------
+// 
+// -----------------------------
+int Events::ShardCount(void) const
+{
+    return (int)shards.size();
+}
+// -----------------------------
+// 
+// -----------------------------
+Events::ShardStats Events::GetShardStats(int index) const
+{
+    const Shard& shard = *shards[index];
+    ShardStats stats;
+    uint64_t dispatched = shard.dispatched.load(std::memory_order_relaxed);
+    uint64_t retired = shardRetired(shard);
+    uint64_t enqueued = shard.enqueued.load(std::memory_order_relaxed);
+    stats.depth = enqueued > retired ? (int)(enqueued - retired) : 0;
+    stats.maxDepth = shard.maxDepth.load(std::memory_order_relaxed);
+    stats.dispatched = dispatched;
+    stats.p50Us = shardLatency.PercentileUs(index, 0.50f);
+    stats.p99Us = shardLatency.PercentileUs(index, 0.99f);
+    stats.maxUs = shardLatency.MaxUs(index);
+    return stats;
+}
+// -----------------------------
+// 
+// -----------------------------
+uint64_t Events::shardRetired(const Shard& shard)
+{
+    return shard.dispatched.load(std::memory_order_relaxed) + shard.merged.load(std::memory_order_relaxed)
+        + shard.discarded.load(std::memory_order_relaxed);
+}
+// -----------------------------
+// 
+// -----------------------------
+void Events::PrintShardSummary(FILE* f) const
+{
+    if (shards.empty())
+    {
+        return;
+    }
+    fprintf(f, "Dispatch workers, enqueue-to-dispatch latency in us (bucket upper bounds)\n");
+    fprintf(f, "%-8s %9s %9s %10s %9s %9s %9s\n", "worker", "depth", "max depth", "dispatched", "p50", "p99", "max");
+    for (int i = 0; i < ShardCount(); ++i)
+    {
+        ShardStats stats = GetShardStats(i);
+        fprintf(f, "%-8d %9d %9d %10llu %9llu %9llu %9llu\n", i, stats.depth, stats.maxDepth,
+            (unsigned long long)stats.dispatched, (unsigned long long)stats.p50Us,
+            (unsigned long long)stats.p99Us, (unsigned long long)stats.maxUs);
+    }
+}
+// -----------------------------
+// 
+// -----------------------------
+Events::TimerId Events::ScheduleAt(std::chrono::steady_clock::time_point deadline, int type, MyEvent event)
+{
+    return schedule(deadline, std::chrono::steady_clock::duration::zero(), type, event);
+}
+// -----------------------------
+// 
+// -----------------------------
+Events::TimerId Events::ScheduleEvery(std::chrono::steady_clock::duration period, int type, MyEvent event)
+{
+    return schedule(std::chrono::steady_clock::now() + period, period, type, event);
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::CancelTimer(TimerId id)
+{
+    std::lock_guard<std::mutex> lock(timersMutex);
+    return timers.Cancel(id);
+}
+// -----------------------------
+// 
+// -----------------------------
+Events::TimerId Events::schedule(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::duration period, int type, const MyEvent& event)
+{
+    std::lock_guard<std::mutex> lock(timersMutex);
+    TimerId id = timers.Schedule(deadline, period, TimerEvent{ type, event });
+    if (deadline < loopWaitUntil)
+    {
+        queue.enqueue(constants::EVENT_TYPE_WAKEUP, MyEvent(constants::GUI_COMMAND_NONE, 0));
+    }
+    return id;
+}
+// -----------------------------
+// 
+// -----------------------------
+int Events::CoalesceKey(int command)
+{
+    switch (command)
+    {
+    case constants::GUI_COMMAND_GOTO:
+    case constants::GUI_COMMAND_JUMP_TO_CURSOR:
+    case constants::GUI_COMMAND_SET_ORIGIN:
+        return command;
+    default:
+        return 0;
+    }
+}
+// -----------------------------
+// 
+// -----------------------------
+bool Events::ReplayJournal(const char* path, double speed, int workers, FILE* f)
+{
+    EventJournal source;
+    if (!source.Open(path, 0))
+    {
+        fprintf(f, "Cannot open the event journal %s\n", path);
+        return false;
+    }
+    Events events;
+    events.Run(workers);
+    events.CancelTimer(events.dataPollTimer);
+    events.dataPollTimer = 0;
+    uint64_t count = source.Count();
+    uint64_t replayed = 0;
+    uint64_t rejected = 0;
+    uint64_t missing = 0;
+    int64_t firstNs = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        EventJournal::Record record;
+        if (!source.Read(i, record))
+        {
+            ++missing;
+            continue;
+        }
+        if (replayed + rejected == 0)
+        {
+            firstNs = record.timeNs;
+        }
+        else if (speed > 0 && record.timeNs > firstNs)
+        {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds((int64_t)((record.timeNs - firstNs) / speed)));
+        }
+        MyEvent event(record.code, record.priority);
+        event.coalesceKey = record.coalesceKey;
+        event.orderingKey = record.orderingKey;
+        if (events.Enqueue(record.type, event))
+        {
+            ++replayed;
+        }
+        else
+        {
+            ++rejected;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    while (events.HasPendingEvents())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    events.Stop();
+    fprintf(f, "Replayed %llu of %llu journal records in %.3f s, %.0f events/s; %llu dropped by queue bounds, %llu never committed\n",
+        (unsigned long long)replayed, (unsigned long long)count, seconds, seconds > 0 ? replayed / seconds : 0.0,
+        (unsigned long long)rejected, (unsigned long long)missing);
+    events.latency.PrintSummary(f);
+    events.PrintShardSummary(f);
+    events.PrintQueueBoundSummary(f);
+    return true;
+}
+
+// -----------------------------
+// Queue benchmarks
+// -----------------------------
+namespace
+{
+    struct OrderedBenchPolicy
+    {
+        template <typename Item>
+        using QueueList = eventpp::OrderedQueueList<Item, MyCompare >;
+    };
+
+    struct PriorityBenchPolicy
+    {
+        template <typename Item>
+        using QueueList = eventpp::PriorityQueueList<Item, MyPriority >;
+    };
+
+    // Payload as GUILoop used to send it: a heap object and a shared_ptr
+    // control block per event.
+    class HeapPriority
+    {
+    public:
+        template <typename T>
+        int operator() (const T& a) const
+        {
+            return a.template getArgument<0>()->priority;
+        }
+    };
+
+    struct HeapBenchPolicy
+    {
+        template <typename Item>
+        using QueueList = eventpp::PriorityQueueList<Item, HeapPriority >;
+    };
+
+    struct BenchResult
+    {
+        int queued;
+        double enqueueNs;
+        double processNs;
+        bool ordered;
+    };
+
+    // Queues count events with 4 priorities interleaved, as a status burst
+    // would, then dispatches them. Enqueueing stops early once it has taken
+    // budgetMs. The listener checks the dispatch order: priorities never
+    // rise and events of one priority come in enqueue order.
+    template <typename Policy>
+    BenchResult benchQueue(const std::vector<MyEvent>& events, int count, double budgetMs)
+    {
+        eventpp::EventQueue<int, void(const MyEvent&), Policy> queue;
+        BenchResult result;
+        result.ordered = true;
+        int lastPriority = 1 << 30;
+        int lastSeq = -1;
+        queue.appendListener(constants::EVENT_TYPE_GUI, [&](const MyEvent& event)
+        {
+            if (event.priority > lastPriority || (event.priority == lastPriority && event.e < lastSeq))
+            {
+                result.ordered = false;
+            }
+            lastPriority = event.priority;
+            lastSeq = event.e;
+        });
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        int queued = 0;
+        while (queued < count)
+        {
+            queue.enqueue(constants::EVENT_TYPE_GUI, events[queued]);
+            ++queued;
+            if ((queued & 255) == 0
+                && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() > budgetMs)
+            {
+                break;
+            }
+        }
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        queue.process();
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+        result.queued = queued;
+        result.enqueueNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / queued;
+        result.processNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / queued;
+        return result;
+    }
+
+    void printResult(FILE* f, const char* name, int count, const BenchResult& r)
+    {
+        fprintf(f, "  %-18s %7d %12.1f %12.1f  %s", name, count, r.enqueueNs, r.processNs, r.ordered ? "ok" : "WRONG ORDER");
+        if (r.queued < count)
+        {
+            fprintf(f, " (stopped after %d events)", r.queued);
+        }
+        fprintf(f, "\n");
+    }
+
+    // Enqueue + dispatch throughput, millions of events per second. Events
+    // are sent in bursts of BURST and processed after each burst, as the
+    // events loop does while a jog button is held.
+    const int BURST = 64;
+
+    double benchHeapEvents(int total)
+    {
+        eventpp::EventQueue<int, void(std::shared_ptr<MyEvent>), HeapBenchPolicy> queue;
+        long long sum = 0;
+        queue.appendListener(constants::EVENT_TYPE_GUI, [&sum](std::shared_ptr<MyEvent> event)
+        {
+            sum += event->e;
+        });
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < total; i += BURST)
+        {
+            for (int j = 0; j < BURST; ++j)
+            {
+                queue.enqueue(constants::EVENT_TYPE_GUI, std::shared_ptr<MyEvent>(new MyEvent(i + j, 1)));
+            }
+            queue.process();
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return sum > 0 ? total / s / 1e6 : 0;
+    }
+
+    double benchInlineEvents(int total)
+    {
+        EQ queue;
+        long long sum = 0;
+        queue.appendListener(constants::EVENT_TYPE_GUI, [&sum](const MyEvent& event)
+        {
+            sum += event.e;
+        });
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < total; i += BURST)
+        {
+            for (int j = 0; j < BURST; ++j)
+            {
+                queue.enqueue(constants::EVENT_TYPE_GUI, MyEvent(i + j, 1));
+            }
+            queue.process();
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return sum > 0 ? total / s / 1e6 : 0;
+    }
+
+    double benchBatchEvents(int total)
+    {
+        EQ queue;
+        long long sum = 0;
+        queue.appendListener(constants::EVENT_TYPE_GUI, [&sum](const MyEvent& event)
+        {
+            sum += event.e;
+        });
+        std::vector<MyEvent> burst;
+        burst.reserve(BURST);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < total; i += BURST)
+        {
+            burst.clear();
+            for (int j = 0; j < BURST; ++j)
+            {
+                burst.push_back(MyEvent(i + j, 1));
+            }
+            queue.enqueueBatch(constants::EVENT_TYPE_GUI, burst);
+            queue.process();
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return sum > 0 ? total / s / 1e6 : 0;
+    }
+
+    struct LinkedDispatchPolicy
+    {
+    };
+
+    struct VectorDispatchPolicy
+    {
+        using CallbackStorage = eventpp::CallbackVector;
+    };
+
+    // ns per dispatch of one event to listeners listeners.
+    template <typename Policy>
+    double benchDispatch(int listeners, int dispatches)
+    {
+        eventpp::EventDispatcher<int, void(const MyEvent&), Policy> dispatcher;
+        long long sum = 0;
+        for (int i = 0; i < listeners; ++i)
+        {
+            dispatcher.appendListener(constants::EVENT_TYPE_GUI, [&sum](const MyEvent& event)
+            {
+                sum += event.e;
+            });
+        }
+        MyEvent event(1, 1);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < dispatches; ++i)
+        {
+            dispatcher.dispatch(constants::EVENT_TYPE_GUI, event);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        return sum == (long long)listeners * dispatches ? ns / dispatches : -1;
+    }
+
+    // Listeners added and removed while a dispatch is always running: one
+    // listener holds the first dispatch until the end. The dispatches from
+    // this thread must still call the added listeners and not the removed.
+    bool checkOverlappingDispatch(int rounds)
+    {
+        eventpp::EventDispatcher<int, void(const MyEvent&), VectorDispatchPolicy> dispatcher;
+        std::atomic<bool> holding(false);
+        std::atomic<bool> release(false);
+        dispatcher.appendListener(constants::EVENT_TYPE_GUI, [&](const MyEvent& event)
+        {
+            if (event.e == 0)
+            {
+                holding.store(true);
+                while (!release.load())
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        std::thread holder([&]()
+        {
+            dispatcher.dispatch(constants::EVENT_TYPE_GUI, MyEvent(0, 1));
+        });
+        while (!holding.load())
+        {
+            std::this_thread::yield();
+        }
+        int calls = 0;
+        int removedCalls = 0;
+        bool ok = true;
+        for (int round = 0; round < rounds && ok; ++round)
+        {
+            auto added = dispatcher.appendListener(constants::EVENT_TYPE_GUI, [&calls](const MyEvent&)
+            {
+                ++calls;
+            });
+            auto removed = dispatcher.appendListener(constants::EVENT_TYPE_GUI, [&removedCalls](const MyEvent&)
+            {
+                ++removedCalls;
+            });
+            dispatcher.removeListener(constants::EVENT_TYPE_GUI, removed);
+            dispatcher.dispatch(constants::EVENT_TYPE_GUI, MyEvent(1, 1));
+            dispatcher.removeListener(constants::EVENT_TYPE_GUI, added);
+            dispatcher.dispatch(constants::EVENT_TYPE_GUI, MyEvent(1, 1));
+            ok = calls == round + 1 && removedCalls == 0;
+        }
+        release.store(true);
+        holder.join();
+        return ok;
+    }
+
+    struct OrderedMapPolicy
+    {
+        using Threading = eventpp::SingleThreading;
+        using CallbackStorage = eventpp::CallbackVector;
+        template <typename Key, typename T>
+        using Map = std::map<Key, T>;
+    };
+
+    struct HashMapPolicy
+    {
+        using Threading = eventpp::SingleThreading;
+        using CallbackStorage = eventpp::CallbackVector;
+        template <typename Key, typename T>
+        using Map = std::unordered_map<Key, T>;
+    };
+
+    struct FlatMapPolicy
+    {
+        using Threading = eventpp::SingleThreading;
+        using CallbackStorage = eventpp::CallbackVector;
+        template <typename Key, typename T>
+        using Map = eventpp::FlatIndexMap<Key, T>;
+    };
+
+    // ns per dispatch, one listener on each of types event types,
+    // the dispatches cycle through the types. Single threaded, so the
+    // locks don't hide the cost of the lookup.
+    template <typename Policy>
+    double benchLookup(int types, int dispatches)
+    {
+        eventpp::EventDispatcher<int, void(const MyEvent&), Policy> dispatcher;
+        long long sum = 0;
+        for (int type = 0; type < types; ++type)
+        {
+            dispatcher.appendListener(type, [&sum](const MyEvent& event)
+            {
+                sum += event.e;
+            });
+        }
+        MyEvent event(1, 1);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < dispatches; ++i)
+        {
+            dispatcher.dispatch(i & (types - 1), event);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        return sum == dispatches ? ns / dispatches : -1;
+    }
+
+    // Payloads sharing one ordered stream with the commands in benchMixedStream.
+    struct TelemetrySample
+    {
+        int seq;
+        float values[6];
+    };
+
+    struct FileProgress
+    {
+        int seq;
+        long long done;
+        long long total;
+    };
+
+    const int BENCH_TELEMETRY = 100;
+    const int BENCH_FILE_PROGRESS = 101;
+
+    using MixedPrototypes = eventpp::HeterTuple<
+        void(const MyEvent&),
+        void(const TelemetrySample&),
+        void(const FileProgress&)
+    >;
+
+    struct ByteRingBenchPolicy
+    {
+        using QueueRing = eventpp::ByteRing<64 * 1024>;
+    };
+
+    // Enqueue + dispatch throughput of a stream mixing the three payload
+    // types, Mevents/s, 0 if the stream came out of order.
+    template <typename Policy>
+    double benchMixedStream(int total)
+    {
+        eventpp::HeterEventQueue<int, MixedPrototypes, Policy> queue;
+        int next = 0;
+        bool ordered = true;
+        queue.appendListener(constants::EVENT_TYPE_GUI, [&](const MyEvent& event)
+        {
+            ordered = ordered && event.e == next++;
+        });
+        queue.appendListener(BENCH_TELEMETRY, [&](const TelemetrySample& sample)
+        {
+            ordered = ordered && sample.seq == next++;
+        });
+        queue.appendListener(BENCH_FILE_PROGRESS, [&](const FileProgress& progress)
+        {
+            ordered = ordered && progress.seq == next++;
+        });
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < total; i += BURST)
+        {
+            for (int seq = i; seq < i + BURST; ++seq)
+            {
+                // Mostly telemetry, as while a file is streamed to the device.
+                switch (seq % 8)
+                {
+                case 0:
+                    queue.enqueue(constants::EVENT_TYPE_GUI, MyEvent(seq, 1));
+                    break;
+                case 1:
+                    queue.enqueue(BENCH_FILE_PROGRESS, FileProgress{ seq, seq, total });
+                    break;
+                default:
+                    queue.enqueue(BENCH_TELEMETRY, TelemetrySample{ seq, { 0, 0, 0, 0, 0, 0 } });
+                    break;
+                }
+            }
+            queue.process();
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return ordered && next == total ? total / s / 1e6 : 0;
+    }
+
+    // Default policies: std::list queue behind a mutex, FIFO.
+    using LockedEQ = eventpp::EventQueue<int, void(const MyEvent&)>;
+
+    struct ContentionResult
+    {
+        double rate;
+        size_t fullWaits;
+        bool ordered;
+    };
+
+    template <typename Queue>
+    size_t fullWaitCount(const Queue&)
+    {
+        return 0;
+    }
+
+    size_t fullWaitCount(const MpscEQ& queue)
+    {
+        return queue.getFullWaitCount();
+    }
+
+    // producers threads enqueue perProducer events each while this thread
+    // waits on the queue and dispatches, as the events loop does. The
+    // listener checks that every producer's events arrive in its order.
+    template <typename Queue>
+    ContentionResult benchProducers(int producers, int perProducer)
+    {
+        Queue queue;
+        ContentionResult result;
+        result.ordered = true;
+        std::vector<int> next(producers, 0);
+        int received = 0;
+        queue.appendListener(constants::EVENT_TYPE_GUI, [&](const MyEvent& event)
+        {
+            if (event.e != next[event.priority])
+            {
+                result.ordered = false;
+            }
+            next[event.priority] = event.e + 1;
+            ++received;
+        });
+
+        const int total = producers * perProducer;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&queue, p, perProducer]()
+            {
+                for (int i = 0; i < perProducer; ++i)
+                {
+                    queue.enqueue(constants::EVENT_TYPE_GUI, MyEvent(i, p));
+                }
+            });
+        }
+        while (received < total)
+        {
+            queue.waitFor(std::chrono::milliseconds(10));
+            queue.process();
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        result.rate = total / s / 1e6;
+        result.fullWaits = fullWaitCount(queue);
+        return result;
+    }
+}
+
+void Events::BenchmarkQueues(FILE* f)
+{
+    const int SIZES[] = { 10, 1000, 100000 };
+    const int RUNS = 5;
+    const double BUDGET_MS = 5000;
+    std::vector<MyEvent> events;
+    events.reserve(100000);
+    for (int i = 0; i < 100000; ++i)
+    {
+        events.push_back(MyEvent(i, i % 4));
+    }
+    fprintf(f, "Event queue lists, best of %d runs, ns per event:\n", RUNS);
+    fprintf(f, "  %-18s %7s %12s %12s\n", "list", "events", "enqueue", "process");
+    for (int count : SIZES)
+    {
+        BenchResult ordered = benchQueue<OrderedBenchPolicy>(events, count, BUDGET_MS);
+        BenchResult priority = benchQueue<PriorityBenchPolicy>(events, count, BUDGET_MS);
+        // The order is checked on every run, not only on the fastest one.
+        bool orderedOk = ordered.ordered;
+        bool priorityOk = priority.ordered;
+        for (int run = 1; run < RUNS && ordered.queued == count; ++run)
+        {
+            BenchResult r = benchQueue<OrderedBenchPolicy>(events, count, BUDGET_MS);
+            orderedOk = orderedOk && r.ordered;
+            if (r.enqueueNs + r.processNs < ordered.enqueueNs + ordered.processNs)
+            {
+                ordered = r;
+            }
+        }
+        for (int run = 1; run < RUNS; ++run)
+        {
+            BenchResult r = benchQueue<PriorityBenchPolicy>(events, count, BUDGET_MS);
+            priorityOk = priorityOk && r.ordered;
+            if (r.enqueueNs + r.processNs < priority.enqueueNs + priority.processNs)
+            {
+                priority = r;
+            }
+        }
+        ordered.ordered = orderedOk;
+        priority.ordered = priorityOk;
+        printResult(f, "OrderedQueueList", count, ordered);
+        printResult(f, "PriorityQueueList", count, priority);
+    }
+
+    const int TOTAL = 1 << 20;
+    double heapRate = 0;
+    double inlineRate = 0;
+    double batchRate = 0;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        heapRate = std::max(heapRate, benchHeapEvents(TOTAL));
+        inlineRate = std::max(inlineRate, benchInlineEvents(TOTAL));
+        batchRate = std::max(batchRate, benchBatchEvents(TOTAL));
+    }
+    fprintf(f, "Enqueue + dispatch, bursts of %d, best of %d runs, Mevents/s:\n", BURST, RUNS);
+    fprintf(f, "  shared_ptr<MyEvent> %8.2f\n", heapRate);
+    fprintf(f, "  MyEvent by value    %8.2f\n", inlineRate);
+    fprintf(f, "  enqueueBatch        %8.2f\n", batchRate);
+
+    double listMixedRate = 0;
+    double ringMixedRate = 0;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        listMixedRate = std::max(listMixedRate, benchMixedStream<eventpp::DefaultPolicies>(TOTAL));
+        ringMixedRate = std::max(ringMixedRate, benchMixedStream<ByteRingBenchPolicy>(TOTAL));
+    }
+    fprintf(f, "Commands, telemetry and file progress in one HeterEventQueue, Mevents/s:\n");
+    fprintf(f, "  list of buffers     %8.2f\n", listMixedRate);
+    fprintf(f, "  ByteRing            %8.2f\n", ringMixedRate);
+
+    const int PRODUCERS[] = { 1, 2, 4, 8 };
+    const int PER_PRODUCER = 1 << 18;
+    fprintf(f, "Producer threads -> one consumer, %d events each, best of %d runs:\n", PER_PRODUCER, RUNS);
+    fprintf(f, "  %-9s %14s %14s %10s\n", "producers", "mutex Mev/s", "MpscRing Mev/s", "full waits");
+    for (int producers : PRODUCERS)
+    {
+        ContentionResult locked = benchProducers<LockedEQ>(producers, PER_PRODUCER);
+        ContentionResult ring = benchProducers<MpscEQ>(producers, PER_PRODUCER);
+        // Like the queue lists, any run out of order fails the row.
+        bool ordered = locked.ordered && ring.ordered;
+        for (int run = 1; run < RUNS; ++run)
+        {
+            ContentionResult r = benchProducers<LockedEQ>(producers, PER_PRODUCER);
+            ordered = ordered && r.ordered;
+            if (r.rate > locked.rate)
+            {
+                locked = r;
+            }
+            r = benchProducers<MpscEQ>(producers, PER_PRODUCER);
+            ordered = ordered && r.ordered;
+            if (r.rate > ring.rate)
+            {
+                ring = r;
+            }
+        }
+        fprintf(f, "  %-9d %14.2f %14.2f %10zu  %s\n", producers, locked.rate, ring.rate, ring.fullWaits,
+            ordered ? "ok" : "WRONG ORDER");
+    }
+
+    const int LISTENERS[] = { 1, 10, 100, 1000 };
+    fprintf(f, "Dispatch to N listeners, best of %d runs, ns per dispatch:\n", RUNS);
+    fprintf(f, "  %-9s %12s %12s\n", "listeners", "linked list", "vector");
+    for (int listeners : LISTENERS)
+    {
+        const int dispatches = std::max(1000, 2000000 / listeners);
+        double linked = 0;
+        double vector = 0;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            double r = benchDispatch<LinkedDispatchPolicy>(listeners, dispatches);
+            linked = run == 0 ? r : std::min(linked, r);
+            r = benchDispatch<VectorDispatchPolicy>(listeners, dispatches);
+            vector = run == 0 ? r : std::min(vector, r);
+        }
+        fprintf(f, "  %-9d %12.1f %12.1f\n", listeners, linked, vector);
+    }
+    fprintf(f, "  vector listeners changed during overlapping dispatches: %s\n",
+        checkOverlappingDispatch(10000) ? "ok" : "FAILED");
+
+    // Event types are powers of two so the dispatch loop can mask.
+    const int TYPES[] = { 4, 16, 64, 256 };
+    const int LOOKUPS = 2000000;
+    fprintf(f, "Listener lookup by event type, best of %d runs, ns per dispatch:\n", RUNS);
+    fprintf(f, "  %-9s %12s %14s %12s\n", "types", "std::map", "unordered_map", "FlatIndexMap");
+    for (int types : TYPES)
+    {
+        double ordered = 0;
+        double hashed = 0;
+        double flat = 0;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            double r = benchLookup<OrderedMapPolicy>(types, LOOKUPS);
+            ordered = run == 0 ? r : std::min(ordered, r);
+            r = benchLookup<HashMapPolicy>(types, LOOKUPS);
+            hashed = run == 0 ? r : std::min(hashed, r);
+            r = benchLookup<FlatMapPolicy>(types, LOOKUPS);
+            flat = run == 0 ? r : std::min(flat, r);
+        }
+        fprintf(f, "  %-9d %12.1f %14.1f %12.1f\n", types, ordered, hashed, flat);
+    }
+}
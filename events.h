@@ -1,43 +1,109 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "eventpp/eventqueue.h"
+#include "eventpp/mixins/mixinfilter.h"
+#include "eventpp/utilities/flatindexmap.h"
 #include "eventpp/utilities/orderedqueuelist.h"
+#include "eventpp/utilities/priorityqueuelist.h"
+#include "EventBridge.h"
+#include "EventJournal.h"
+#include "EventLatency.h"
+#include "SpscChannel.h"
+#include "TimerWheel.h"
+#include "constants.h"
 #include "spdlog/spdlog.h"
 #include "spdlog/cfg/env.h" // support for loading levels from the environment variable
 class MyEvent;
 class MyPolicy;
-using EQ = eventpp::EventQueue<int, void(std::shared_ptr<MyEvent>), MyPolicy>;
+// Events are stored by value in the queue items, which the queue recycles
+// through its free list: no allocation per event once the list has grown
+// to the burst size.
+using EQ = eventpp::EventQueue<int, void(const MyEvent&), MyPolicy>;
 // -----------------------------
 // 
 // -----------------------------
 // First let's define the event struct. e is the event type, priority determines the priority.
+// Keep it small and trivially copyable, it is copied into the queue.
 class MyEvent
 {
 public:
     int e;
     int priority=0;
-    MyEvent(int e, int piority)
+    // Set by Events::Enqueue(), events with the default value are not timed.
+    std::chrono::steady_clock::time_point enqueueTime;
+    // Non-zero: a pending event with the same key and priority is replaced
+    // by this one instead of being dispatched too, see MyCoalesce.
+    int coalesceKey = 0;
+    // Number of pending events this one replaced.
+    int merged = 0;
+    // With dispatch workers, events with the same key are serialized;
+    // 0 uses the event type as the key.
+    int orderingKey = 0;
+    // Set by Events::Enqueue() for a bounded type: the type, and the
+    // events counted against its bound, 1 or the sum MyCoalesce makes.
+    int boundType = -1;
+    int admitted = 0;
+    MyEvent(int e, int priority)
     {
-        std::cout << "Event created" << std::endl;
         this->e = e;
         this->priority = priority;
     }
-    ~MyEvent()
-    {        
-        std::cout << "Event destroyed" << std::endl;
-    }
 };
 
 // The comparison function object used by eventpp::OrderedQueueList.
 // The function compares the event by priority.
+// Kept for Events::BenchmarkQueues(), the queue uses MyPriority.
 class MyCompare
 {
 public:
     template <typename T>
     bool operator() (const T& a, const T& b) const
     {
-        return a.template getArgument<0>()->priority > b.template getArgument<0>()->priority;
+        return a.template getArgument<0>().priority > b.template getArgument<0>().priority;
+    }
+};
+
+// The priority function object used by eventpp::PriorityQueueList.
+class MyPriority
+{
+public:
+    template <typename T>
+    int operator() (const T& a) const
+    {
+        return a.template getArgument<0>().priority;
+    }
+};
+
+// The coalescing policy used by eventpp::PriorityQueueList. The newest
+// event wins; it keeps the enqueue time of the oldest, so the latency
+// histogram shows how long the key waited, and counts the merges.
+class MyCoalesce
+{
+public:
+    template <typename T>
+    int key(const T& a) const
+    {
+        return a.template getArgument<0>().coalesceKey;
+    }
+
+    template <typename T>
+    void merge(T& pending, T& incoming) const
+    {
+        MyEvent& older = std::get<0>(pending.arguments);
+        MyEvent& newer = std::get<0>(incoming.arguments);
+        newer.merged = older.merged + newer.merged + 1;
+        newer.admitted = older.admitted + newer.admitted;
+        newer.enqueueTime = older.enqueueTime;
+        pending = std::move(incoming);
     }
 };
 
@@ -45,8 +111,17 @@ public:
 class MyPolicy
 {
 public:
+    // Higher priority first, FIFO within a priority, O(log priorities) per enqueue,
+    // events with a coalescing key merged into the pending one.
     template <typename Item>
-    using QueueList = eventpp::OrderedQueueList<Item, MyCompare >;
+    using QueueList = eventpp::PriorityQueueList<Item, MyPriority, MyCoalesce >;
+    // The filter times every event right before its listeners run.
+    using Mixins = eventpp::MixinList<eventpp::MixinFilter>;
+    // Listeners of an event type in one vector: dispatch walks it by index.
+    using CallbackStorage = eventpp::CallbackVector;
+    // Event types are small constants: the listener lookup is an array index.
+    template <typename Key, typename T>
+    using Map = eventpp::FlatIndexMap<Key, T, 16>;
 
     static int getEvent(const MyEvent* event)
     {
@@ -54,6 +129,28 @@ public:
     }
 };
 
+// Lock-free FIFO storage for events enqueued from several threads, see the
+// contention table of Events::BenchmarkQueues(). No priority ordering.
+class MyMpscPolicy
+{
+public:
+    using QueueRing = eventpp::MpscRing<4096>;
+};
+using MpscEQ = eventpp::EventQueue<int, void(const MyEvent&), MyMpscPolicy>;
+
+// A result the events side reports to the GUI thread, see Events::PostToGui().
+// Fixed size so the channel copies it without allocating.
+struct GuiUpdate
+{
+    // constants::GUI_UPDATE_*
+    int kind;
+    // Command or device state.
+    int code;
+    char text[constants::GUI_UPDATE_TEXT_LENGTH];
+    // text is UTF-8, cut on a character boundary if too long.
+    GuiUpdate(int kind = 0, int code = 0, const char* text = "");
+};
+
 // -----------------------------
 // 
 // -----------------------------
@@ -63,13 +160,175 @@ public:
     Events();
     ~Events();
 
-    void Run(void);
+    // workers > 0: events are dispatched by that many threads, sharded by
+    // ordering key; 0: by the events loop thread.
+    void Run(int workers = 0);
     void Stop(void);
+    // Stamps the event for the latency histogram and queues it, applying
+    // the queue bound of type. False when the bound dropped the event.
+    bool Enqueue(int type, MyEvent event);
+    // Enqueue() that never waits: a full blocking bound drops the event,
+    // for threads serving several producers such as the bridge.
+    bool TryEnqueue(int type, MyEvent event);
+    // Most events of type pending at once, 0 for no bound, and what
+    // Enqueue() does beyond it: one of constants::QUEUE_OVERFLOW_*.
+    void SetQueueBound(int type, int capacity, int overflow);
+    // Coalescing key of a GUI command: commands where only the latest one
+    // pending matters get their own code, the others 0.
+    static int CoalesceKey(int command);
+    // Ordering key of a GUI command: device commands are serialized with
+    // the data polls, file commands run beside them.
+    static int OrderingKey(int command);
+    // Events queued and not dispatched yet, in any queue.
+    bool HasPendingEvents(void) const;
+
+    struct ShardStats
+    {
+        int depth;
+        int maxDepth;
+        uint64_t dispatched;
+        uint64_t p50Us;
+        uint64_t p99Us;
+        uint64_t maxUs;
+    };
+    struct QueueBoundStats
+    {
+        int capacity;
+        int overflow;
+        int pending;
+        // Most events of the type pending at once.
+        int highWater;
+        uint64_t dropped;
+        // Enqueue() calls that had to wait for room.
+        uint64_t blocked;
+        uint64_t coalesced;
+    };
+    QueueBoundStats GetQueueBoundStats(int type) const;
+    static const char* OverflowName(int overflow);
+    // GetQueueBoundStats() of the bounded types for the headless run.
+    void PrintQueueBoundSummary(FILE* f) const;
+
+    // Reports to the GUI thread. Lock-free on the events loop and the
+    // dispatch workers, each has its own channel; other threads share one
+    // under a mutex. Updates from one thread arrive in order. False when
+    // the channel is full and the update was dropped.
+    bool PostToGui(const GuiUpdate& update);
+    // GUI thread only: moves up to max pending updates to out, returns
+    // how many.
+    int TakeGuiUpdates(GuiUpdate* out, int max);
+    // Called, from the posting thread, when an update arrives and the GUI
+    // has taken all the earlier ones. nullptr to remove it.
+    void SetGuiWakeup(std::function<void()> wakeup);
+    uint64_t GuiUpdatesDropped(void) const;
+
+    // Dispatch workers of the current Run(), 0 without.
+    int ShardCount(void) const;
+    ShardStats GetShardStats(int shard) const;
+    // Table of GetShardStats() for the headless run, nothing without workers.
+    void PrintShardSummary(FILE* f) const;
+
+    // Timed events: the events loop enqueues event with type when the
+    // deadline passes and records how late it fired in timerLateness.
+    // Callable from any thread; Cancel returns false once a one-shot
+    // timer has fired.
+    using TimerId = uint64_t;
+    TimerId ScheduleAt(std::chrono::steady_clock::time_point deadline, int type, MyEvent event);
+    // First at now + period, then every period on the same phase.
+    TimerId ScheduleEvery(std::chrono::steady_clock::duration period, int type, MyEvent event);
+    bool CancelTimer(TimerId id);
+    // Feeds the events of the journal at path to a new Events with workers
+    // dispatch workers through Enqueue(), at speed times the original
+    // pace (0: without waiting), and prints the replay and its latency
+    // histogram. Journaled data polls stand in for the poll timer.
+    static bool ReplayJournal(const char* path, double speed, int workers, FILE* f);
+    // Enqueue + process() cost of the queue list policies at several depths
+    // and the throughput of heap allocated against by-value and batched events, then
+    // 1-8 producer threads against the mutex queue and MpscEQ, and the
+    // dispatch cost with 1-1000 listeners of the linked and vector lists.
+    static void BenchmarkQueues(FILE* f);
     bool isEventsLoopRunning;
     EQ queue;
+    EventLatency latency;
+    EventLatency timerLateness;
+    // When open, Enqueue() records every event it queues; open it before Run().
+    EventJournal journal;
+    // When started, local clients queue events and get the GUI updates
+    // too; start it after Run(), Stop() stops it.
+    EventBridge bridge;
 private:
-    bool needStop;
+    struct TimerEvent
+    {
+        int type;
+        MyEvent event;
+    };
+
+    // A dispatch worker. Its queue only stores events, they are dispatched
+    // to the listeners of Events::queue.
+    struct Shard
+    {
+        EQ queue;
+        std::thread thread;
+        std::atomic<uint64_t> enqueued;
+        std::atomic<uint64_t> dispatched;
+        // Events replaced by coalescing, never dispatched.
+        std::atomic<uint64_t> merged;
+        // Events removed by a drop-oldest bound, never dispatched.
+        std::atomic<uint64_t> discarded;
+        std::atomic<int> maxDepth;
+    };
+
+    struct QueueBound
+    {
+        std::atomic<int> capacity;
+        std::atomic<int> overflow;
+        // Admitted and not dispatched or discarded yet.
+        std::atomic<int> pending;
+        std::atomic<int> highWater;
+        std::atomic<uint64_t> dropped;
+        std::atomic<uint64_t> blocked;
+        std::atomic<uint64_t> coalesced;
+    };
+
+    std::atomic<bool> needStop;
     void eventsLoop(void);
+    void shardLoop(int shard);
+    TimerId schedule(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::duration period, int type, const MyEvent& event);
     std::thread* eventsLoopThread;
+    std::mutex timersMutex;
+    TimerWheel<TimerEvent> timers;
+    // Until when the events loop sleeps, an earlier new timer wakes it.
+    std::chrono::steady_clock::time_point loopWaitUntil;
+    TimerId dataPollTimer;
+    std::vector<std::unique_ptr<Shard> > shards;
+    // Enqueue-to-dispatch latency per shard, the code is the shard index.
+    EventLatency shardLatency;
+    QueueBound bounds[constants::MAX_EVENT_TYPES];
+    // Producers blocked by a full bound wait here for a dispatch.
+    std::mutex boundMutex;
+    std::condition_variable boundFreed;
+    std::atomic<int> boundWaiters;
+    // The events loop, one per dispatch worker, then the shared one.
+    using GuiChannel = SpscChannel<GuiUpdate, constants::GUI_UPDATE_CHANNEL_CAPACITY>;
+    static const int GUI_CHANNELS = constants::MAX_EVENT_WORKERS + 2;
+    std::unique_ptr<GuiChannel[]> guiChannels;
+    // Producers of the shared channel.
+    std::mutex guiSharedMutex;
+    // Channel TakeGuiUpdates() starts with, so a busy one can't starve the others.
+    int guiTakeStart;
+    // Set by the post that wakes the GUI, cleared as it takes the updates.
+    std::atomic<bool> guiWakePending;
+    std::mutex guiWakeupMutex;
+    std::function<void()> guiWakeup;
+    std::atomic<uint64_t> guiDropped;
+    static uint64_t shardRetired(const Shard& shard);
+    bool enqueue(int type, MyEvent& event, bool mayWait);
+    // Applies the overflow policy when the bound of type is full; false
+    // when the event must be dropped. A blocking bound only waits when
+    // mayWait is set.
+    bool applyBound(int type, MyEvent& event, bool mayWait);
+    // Takes a slot of the bound, false when it is full.
+    bool admit(QueueBound& bound);
+    // Called as an event leaves the queues, dispatched or discarded.
+    void release(int type, int admitted);
     
 };
@@ -15,6 +15,9 @@
 
 // CHANGELOG
 // (minor and older changes stripped away, please see git history for details)
+//  2021-XX-XX: OpenGL: Added ImGui_ImplOpenGL3_SetDrawOptimizer() to merge compatible draw commands and skip redundant scissor/texture changes.
+//  2021-XX-XX: OpenGL: Added ImGui_ImplOpenGL3_SetStreamMode() to upload a whole frame through one mapped ring buffer, and ImGui_ImplOpenGL3_GetRenderStats().
+//  2021-XX-XX: OpenGL: Added ImGui_ImplOpenGL3_SetFontTextureSdf() to draw signed distance field fonts (ImGuiFreeTypeBuilderFlags_SDF).
 //  2021-XX-XX: Platform: Added support for multiple windows via the ImGuiPlatformIO interface.
 //  2021-08-23: OpenGL: Fixed ES 3.0 shader ("#version 300 es") use normal precision floats to avoid wobbly rendering at HD resolutions.
 //  2021-08-19: OpenGL: Embed and use our own minimal GL loader (imgui_impl_opengl3_loader.h), removing requirement and support for third-party loader.
@@ -148,6 +151,17 @@
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
 #endif
 
+// Desktop GL 3.2+ can stream all draw lists of a frame through one mapped buffer (glMapBufferRange() + base vertex).
+// Desktop GL 4.4+ has glBufferStorage() for a persistently mapped one.
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
+#define IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFERS
+#if defined(GL_VERSION_4_4)
+#define IMGUI_IMPL_OPENGL_MAY_HAVE_BUFFER_STORAGE
+#endif
+#endif
+#define IMGUI_IMPL_OPENGL_STREAM_SECTIONS   3           // Persistent mode: frames in flight
+#define IMGUI_IMPL_OPENGL_STREAM_MIN_COUNT  (1 << 15)   // Smallest ring, in vertices and in indices
+
 // Desktop GL 3.3+ has glBindSampler()
 #if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3) && defined(GL_VERSION_3_3)
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
@@ -172,15 +186,42 @@ struct ImGui_ImplOpenGL3_Data
     GLuint          ShaderHandle;
     GLint           AttribLocationTex;       // Uniforms location
     GLint           AttribLocationProjMtx;
+    GLint           AttribLocationFontSdf;
     GLuint          AttribLocationVtxPos;    // Vertex attributes location
     GLuint          AttribLocationVtxUV;
     GLuint          AttribLocationVtxColor;
     unsigned int    VboHandle, ElementsHandle;
     bool            HasClipOrigin;
+    bool            FontTextureSdf;          // Font texture holds signed distance fields, see ImGui_ImplOpenGL3_SetFontTextureSdf()
+    bool            HasBufferStorage;
+    bool            DrawOptimizer;           // See ImGui_ImplOpenGL3_SetDrawOptimizer()
+    int             StreamMode;              // Requested ImGui_ImplOpenGL3_StreamMode_
+    int             StreamModeActive;        // Mode VboHandle/ElementsHandle were created for, -1 to recreate them
+    GLsizeiptr      StreamVtxSize;           // Ring sizes in bytes (Persistent: per section)
+    GLsizeiptr      StreamIdxSize;
+    GLsizeiptr      StreamVtxHead;           // MapRange: first free byte
+    GLsizeiptr      StreamIdxHead;
+    char*           StreamVtxMapped;         // Persistent: whole buffers, mapped while they live
+    char*           StreamIdxMapped;
+    int             StreamSection;           // Persistent: section written by the current frame
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFERS
+    GLsync          StreamFences[IMGUI_IMPL_OPENGL_STREAM_SECTIONS];
+#endif
+    ImGui_ImplOpenGL3_RenderStats Stats;
 
     ImGui_ImplOpenGL3_Data() { memset(this, 0, sizeof(*this)); }
 };
 
+// Indices drawn with one glDrawElements*() call. The draw optimizer extends it with the following commands sharing its state.
+struct ImGui_ImplOpenGL3_Batch
+{
+    GLint       Scissor[4];     // glScissor() box in framebuffer pixels
+    GLuint      TexId;
+    GLsizeiptr  IdxOffset;      // In bytes
+    GLsizei     ElemCount;
+    GLint       VtxOffset;      // Base vertex
+};
+
 // Backend data stored in io.BackendRendererUserData to allow support for multiple Dear ImGui contexts
 // It is STRONGLY preferred that you use docking branch with multi-viewports (== single Dear ImGui context + multiple windows) instead of multiple Dear ImGui contexts.
 static ImGui_ImplOpenGL3_Data* ImGui_ImplOpenGL3_GetBackendData()
@@ -260,6 +301,7 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
 
     // Detect extensions we support
     bd->HasClipOrigin = (bd->GlVersion >= 450);
+    bd->HasBufferStorage = (bd->GlVersion >= 440);
 #ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_EXTENSIONS
     GLint num_extensions = 0;
     glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
@@ -268,6 +310,8 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
         const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
         if (extension != NULL && strcmp(extension, "GL_ARB_clip_control") == 0)
             bd->HasClipOrigin = true;
+        if (extension != NULL && strcmp(extension, "GL_ARB_buffer_storage") == 0)
+            bd->HasBufferStorage = true;
     }
 #endif
 
@@ -350,6 +394,7 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     glUseProgram(bd->ShaderHandle);
     glUniform1i(bd->AttribLocationTex, 0);
     glUniformMatrix4fv(bd->AttribLocationProjMtx, 1, GL_FALSE, &ortho_projection[0][0]);
+    glUniform1i(bd->AttribLocationFontSdf, 0);
 
 #ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
     if (bd->GlVersion >= 330)
@@ -372,6 +417,251 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     glVertexAttribPointer(bd->AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
 }
 
+// Replace the vertex/index buffer objects, dropping the streaming ring and its fences.
+// Deleting a buffer also unmaps it, the GL keeps its storage until the draws reading it are done.
+static void ImGui_ImplOpenGL3_RecreateBuffers(ImGui_ImplOpenGL3_Data* bd)
+{
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFERS
+    for (int i = 0; i < IMGUI_IMPL_OPENGL_STREAM_SECTIONS; i++)
+        if (bd->StreamFences[i]) { glDeleteSync(bd->StreamFences[i]); bd->StreamFences[i] = NULL; }
+#endif
+    if (bd->VboHandle)      { glDeleteBuffers(1, &bd->VboHandle); bd->VboHandle = 0; }
+    if (bd->ElementsHandle) { glDeleteBuffers(1, &bd->ElementsHandle); bd->ElementsHandle = 0; }
+    glGenBuffers(1, &bd->VboHandle);
+    glGenBuffers(1, &bd->ElementsHandle);
+    bd->StreamModeActive = ImGui_ImplOpenGL3_StreamMode_BufferData;
+    bd->StreamVtxSize = bd->StreamIdxSize = 0;
+    bd->StreamVtxHead = bd->StreamIdxHead = 0;
+    bd->StreamVtxMapped = bd->StreamIdxMapped = NULL;
+    bd->StreamSection = 0;
+}
+
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFERS
+// Copy every draw list of the frame, back to back, into one region of the vertex and the index ring.
+// Returns false when the frame must be uploaded with glBufferData() instead. Otherwise the region starts at
+// *out_vtx_offset/*out_idx_offset bytes and *out_rebound tells that the buffer objects changed (attributes must be set up again).
+// With rebase_indices each command's indices are offset by its first vertex in the region, so all of them draw with the region start as base vertex.
+static bool ImGui_ImplOpenGL3_StreamUpload(ImDrawData* draw_data, bool rebase_indices, GLsizeiptr* out_vtx_offset, GLsizeiptr* out_idx_offset, bool* out_rebound)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    *out_vtx_offset = *out_idx_offset = 0;
+    *out_rebound = false;
+
+    int mode = bd->StreamMode;
+    if (mode == ImGui_ImplOpenGL3_StreamMode_Persistent && !bd->HasBufferStorage)
+        mode = ImGui_ImplOpenGL3_StreamMode_MapRange;
+    if (mode != ImGui_ImplOpenGL3_StreamMode_BufferData && bd->GlVersion < 320)
+        mode = ImGui_ImplOpenGL3_StreamMode_BufferData;
+    if (mode == ImGui_ImplOpenGL3_StreamMode_BufferData)
+    {
+        // Back from a streaming mode: Persistent storage is immutable, glBufferData() needs fresh buffer objects.
+        if (bd->StreamModeActive != ImGui_ImplOpenGL3_StreamMode_BufferData)
+        {
+            ImGui_ImplOpenGL3_RecreateBuffers(bd);
+            *out_rebound = true;
+        }
+        return false;
+    }
+
+    const GLsizeiptr vtx_bytes = (GLsizeiptr)draw_data->TotalVtxCount * (int)sizeof(ImDrawVert);
+    const GLsizeiptr idx_bytes = (GLsizeiptr)draw_data->TotalIdxCount * (int)sizeof(ImDrawIdx);
+    if (mode != bd->StreamModeActive || vtx_bytes > bd->StreamVtxSize || idx_bytes > bd->StreamIdxSize)
+    {
+        // Sizes stay whole numbers of vertices/indices so every region offset is a valid base vertex/index offset.
+        GLsizeiptr vtx_count = IMGUI_IMPL_OPENGL_STREAM_MIN_COUNT;
+        GLsizeiptr idx_count = IMGUI_IMPL_OPENGL_STREAM_MIN_COUNT;
+        while (vtx_count < draw_data->TotalVtxCount * 2)
+            vtx_count *= 2;
+        while (idx_count < draw_data->TotalIdxCount * 2)
+            idx_count *= 2;
+        ImGui_ImplOpenGL3_RecreateBuffers(bd);
+        *out_rebound = true;
+        bd->StreamVtxSize = vtx_count * (int)sizeof(ImDrawVert);
+        bd->StreamIdxSize = idx_count * (int)sizeof(ImDrawIdx);
+        glBindBuffer(GL_ARRAY_BUFFER, bd->VboHandle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->ElementsHandle);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BUFFER_STORAGE
+        if (mode == ImGui_ImplOpenGL3_StreamMode_Persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, bd->StreamVtxSize * IMGUI_IMPL_OPENGL_STREAM_SECTIONS, NULL, flags);
+            glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, bd->StreamIdxSize * IMGUI_IMPL_OPENGL_STREAM_SECTIONS, NULL, flags);
+            bd->StreamVtxMapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bd->StreamVtxSize * IMGUI_IMPL_OPENGL_STREAM_SECTIONS, flags);
+            bd->StreamIdxMapped = (char*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, bd->StreamIdxSize * IMGUI_IMPL_OPENGL_STREAM_SECTIONS, flags);
+            if (bd->StreamVtxMapped == NULL || bd->StreamIdxMapped == NULL)
+            {
+                // Advertised but not working: stay on MapRange from now on.
+                bd->HasBufferStorage = false;
+                bd->Stats.MapStalls++;
+                ImGui_ImplOpenGL3_RecreateBuffers(bd);
+                return false;
+            }
+        }
+        else
+#endif
+        {
+            glBufferData(GL_ARRAY_BUFFER, bd->StreamVtxSize, NULL, GL_STREAM_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, bd->StreamIdxSize, NULL, GL_STREAM_DRAW);
+        }
+        bd->Stats.BufferAllocs += 2;
+        bd->StreamModeActive = mode;
+    }
+    if (draw_data->TotalVtxCount == 0 || draw_data->TotalIdxCount == 0)
+        return true;
+
+    char* vtx_dst = NULL;
+    char* idx_dst = NULL;
+    if (mode == ImGui_ImplOpenGL3_StreamMode_Persistent)
+    {
+        // Wait until the GPU is done with the frame that last used this section.
+        GLsync& fence = bd->StreamFences[bd->StreamSection];
+        if (fence)
+        {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            {
+                bd->Stats.MapStalls++;
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+            }
+            glDeleteSync(fence);
+            fence = NULL;
+        }
+        *out_vtx_offset = bd->StreamVtxSize * bd->StreamSection;
+        *out_idx_offset = bd->StreamIdxSize * bd->StreamSection;
+        vtx_dst = bd->StreamVtxMapped + *out_vtx_offset;
+        idx_dst = bd->StreamIdxMapped + *out_idx_offset;
+    }
+    else
+    {
+        // Regions are only appended, so the unsynchronized maps never touch data a pending draw reads.
+        // At the end of the ring the storage is orphaned: the driver hands out fresh memory instead of waiting.
+        GLbitfield vtx_access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+        GLbitfield idx_access = vtx_access;
+        if (bd->StreamVtxHead + vtx_bytes > bd->StreamVtxSize)
+        {
+            bd->StreamVtxHead = 0;
+            vtx_access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+            bd->Stats.BufferAllocs++;
+        }
+        if (bd->StreamIdxHead + idx_bytes > bd->StreamIdxSize)
+        {
+            bd->StreamIdxHead = 0;
+            idx_access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+            bd->Stats.BufferAllocs++;
+        }
+        *out_vtx_offset = bd->StreamVtxHead;
+        *out_idx_offset = bd->StreamIdxHead;
+        vtx_dst = (char*)glMapBufferRange(GL_ARRAY_BUFFER, bd->StreamVtxHead, vtx_bytes, vtx_access);
+        idx_dst = (char*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, bd->StreamIdxHead, idx_bytes, idx_access);
+        bd->StreamVtxHead += vtx_bytes;
+        bd->StreamIdxHead += idx_bytes;
+    }
+
+    if (vtx_dst != NULL && idx_dst != NULL)
+    {
+        unsigned int list_vtx_start = 0;
+        for (int n = 0; n < draw_data->CmdListsCount; n++)
+        {
+            const ImDrawList* cmd_list = draw_data->CmdLists[n];
+            memcpy(vtx_dst, cmd_list->VtxBuffer.Data, (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+            if (rebase_indices)
+            {
+                ImDrawIdx* dst = (ImDrawIdx*)(void*)idx_dst;
+                for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+                {
+                    const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+                    const ImDrawIdx base = (ImDrawIdx)(list_vtx_start + pcmd->VtxOffset);
+                    const ImDrawIdx* src = cmd_list->IdxBuffer.Data + pcmd->IdxOffset;
+                    for (unsigned int i = 0; i < pcmd->ElemCount; i++)
+                        dst[pcmd->IdxOffset + i] = (ImDrawIdx)(src[i] + base);
+                }
+                list_vtx_start += (unsigned int)cmd_list->VtxBuffer.Size;
+            }
+            else
+            {
+                memcpy(idx_dst, cmd_list->IdxBuffer.Data, (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+            }
+            vtx_dst += cmd_list->VtxBuffer.Size * (int)sizeof(ImDrawVert);
+            idx_dst += cmd_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx);
+        }
+    }
+    bool ok = (vtx_dst != NULL && idx_dst != NULL);
+    if (mode == ImGui_ImplOpenGL3_StreamMode_MapRange)
+    {
+        if (vtx_dst != NULL && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE)
+            ok = false;
+        if (idx_dst != NULL && glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_FALSE)
+            ok = false;
+    }
+    if (!ok)
+    {
+        // Lost mapping (e.g. video mode change): start over with new buffers next frame.
+        bd->Stats.MapStalls++;
+        bd->StreamModeActive = -1;
+        return false;
+    }
+    bd->Stats.BytesUploaded += (ImU64)(vtx_bytes + idx_bytes);
+    return true;
+}
+
+// Persistent mode: the section written by this frame can be reused once the GPU passes this point.
+static void ImGui_ImplOpenGL3_StreamFence(ImGui_ImplOpenGL3_Data* bd)
+{
+    if (bd->StreamModeActive != ImGui_ImplOpenGL3_StreamMode_Persistent)
+        return;
+    GLsync& fence = bd->StreamFences[bd->StreamSection];
+    if (fence) // Empty frame, the section was not waited for: the new fence covers the old one
+        glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    bd->StreamSection = (bd->StreamSection + 1) % IMGUI_IMPL_OPENGL_STREAM_SECTIONS;
+}
+#endif
+
+// True when every vertex of the command lies inside both scissor boxes: the command then draws the same under either of them.
+static bool ImGui_ImplOpenGL3_CmdInsideScissors(const ImDrawList* cmd_list, const ImDrawCmd* pcmd, const GLint* scissor_a, const GLint* scissor_b, ImVec2 clip_off, ImVec2 clip_scale, int fb_height)
+{
+    // Intersection of the boxes, back in Y-down framebuffer space
+    const float x0 = (float)(scissor_a[0] > scissor_b[0] ? scissor_a[0] : scissor_b[0]);
+    const float x1 = (float)(scissor_a[0] + scissor_a[2] < scissor_b[0] + scissor_b[2] ? scissor_a[0] + scissor_a[2] : scissor_b[0] + scissor_b[2]);
+    const float y0 = (float)(fb_height - (scissor_a[1] + scissor_a[3] < scissor_b[1] + scissor_b[3] ? scissor_a[1] + scissor_a[3] : scissor_b[1] + scissor_b[3]));
+    const float y1 = (float)(fb_height - (scissor_a[1] > scissor_b[1] ? scissor_a[1] : scissor_b[1]));
+    const ImDrawVert* vtx = cmd_list->VtxBuffer.Data + pcmd->VtxOffset;
+    const ImDrawIdx* idx = cmd_list->IdxBuffer.Data + pcmd->IdxOffset;
+    for (unsigned int i = 0; i < pcmd->ElemCount; i++)
+    {
+        const ImVec2 pos = vtx[idx[i]].pos;
+        const float x = (pos.x - clip_off.x) * clip_scale.x;
+        const float y = (pos.y - clip_off.y) * clip_scale.y;
+        if (x < x0 || x > x1 || y < y0 || y > y1)
+            return false;
+    }
+    return true;
+}
+
+// Issue one batch. With the draw optimizer the scissor box and texture are only set when they differ from *applied, the state
+// left by the previous batch (*applied_valid is false after SetupRenderState() or a user callback, which may have changed them).
+static void ImGui_ImplOpenGL3_DrawBatch(ImGui_ImplOpenGL3_Data* bd, const ImGui_ImplOpenGL3_Batch& batch, ImGui_ImplOpenGL3_Batch* applied, bool* applied_valid)
+{
+    const bool skip = bd->DrawOptimizer && *applied_valid;
+    if (!skip || memcmp(batch.Scissor, applied->Scissor, sizeof(batch.Scissor)) != 0)
+        glScissor(batch.Scissor[0], batch.Scissor[1], batch.Scissor[2], batch.Scissor[3]);
+    if (!skip || batch.TexId != applied->TexId)
+    {
+        glBindTexture(GL_TEXTURE_2D, batch.TexId);
+        if (bd->FontTextureSdf)
+            glUniform1i(bd->AttribLocationFontSdf, batch.TexId == bd->FontTexture ? 1 : 0);
+    }
+    *applied = batch;
+    *applied_valid = true;
+
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
+    if (bd->GlVersion >= 320)
+        glDrawElementsBaseVertex(GL_TRIANGLES, batch.ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)batch.IdxOffset, batch.VtxOffset);
+    else
+#endif
+    glDrawElements(GL_TRIANGLES, batch.ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)batch.IdxOffset);
+    bd->Stats.DrawCalls++;
+}
+
 // OpenGL3 Render function.
 // Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly.
 // This is in order to be able to run within an OpenGL engine that doesn't do so.
@@ -426,30 +716,69 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 #endif
     ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
 
+    // Streaming modes upload the whole frame at once, draw lists are then addressed by their offset in it.
+    // For the draw optimizer the indices are rebased when they can address the whole frame, so batches may span draw lists.
+    bool stream = false;
+    bool rebased = false;
+    GLsizeiptr stream_vtx_offset = 0;   // Bytes
+    GLsizeiptr stream_idx_offset = 0;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFERS
+    bool rebound = false;
+    const bool rebase = bd->DrawOptimizer && (sizeof(ImDrawIdx) == 4 || draw_data->TotalVtxCount <= 0x10000);
+    stream = ImGui_ImplOpenGL3_StreamUpload(draw_data, rebase, &stream_vtx_offset, &stream_idx_offset, &rebound);
+    rebased = stream && rebase;
+    if (rebound)
+        ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+#endif
+    bd->Stats.ActiveMode = stream ? bd->StreamModeActive : ImGui_ImplOpenGL3_StreamMode_BufferData;
+    const int stream_vtx_base = (int)(stream_vtx_offset / (int)sizeof(ImDrawVert));
+    int list_vtx_offset = stream_vtx_base;  // Vertices
+    int list_idx_offset = 0;                // Indices, after stream_idx_offset
+
     // Will project scissor/clipping rectangles into framebuffer space
     ImVec2 clip_off = draw_data->DisplayPos;         // (0,0) unless using multi-viewports
     ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
 
+    // Pending batch, drawn when the next command cannot join it. Without the draw optimizer every command is its own batch.
+    ImGui_ImplOpenGL3_Batch batch;
+    bool batch_open = false;
+    ImGui_ImplOpenGL3_Batch applied;
+    bool applied_valid = false;
+    memset(&batch, 0, sizeof(batch));
+    memset(&applied, 0, sizeof(applied));
+
     // Render command lists
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
 
         // Upload vertex/index buffers
-        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * (int)sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+        if (!stream)
+        {
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * (int)sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+            bd->Stats.BytesUploaded += (ImU64)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert) + (ImU64)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+            bd->Stats.BufferAllocs += 2;
+        }
 
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
         {
             const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
             if (pcmd->UserCallback != NULL)
             {
+                if (batch_open)
+                {
+                    ImGui_ImplOpenGL3_DrawBatch(bd, batch, &applied, &applied_valid);
+                    batch_open = false;
+                }
+
                 // User callback, registered via ImDrawList::AddCallback()
                 // (ImDrawCallback_ResetRenderState is a special callback value used by the user to request the renderer to reset render state.)
                 if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
                     ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
                 else
                     pcmd->UserCallback(cmd_list, pcmd);
+                applied_valid = false;
             }
             else
             {
@@ -458,21 +787,53 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
                 ImVec2 clip_max((pcmd->ClipRect.z - clip_off.x) * clip_scale.x, (pcmd->ClipRect.w - clip_off.y) * clip_scale.y);
                 if (clip_max.x < clip_min.x || clip_max.y < clip_min.y)
                     continue;
-
-                // Apply scissor/clipping rectangle (Y is inverted in OpenGL)
-                glScissor((int)clip_min.x, (int)(fb_height - clip_max.y), (int)(clip_max.x - clip_min.x), (int)(clip_max.y - clip_min.y));
-
-                // Bind texture, Draw
-                glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->GetTexID());
-#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
-                if (bd->GlVersion >= 320)
-                    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)), (GLint)pcmd->VtxOffset);
-                else
-#endif
-                glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)));
+                bd->Stats.DrawCmds++;
+
+                // Scissor/clipping rectangle (Y is inverted in OpenGL), texture and index range of the command
+                ImGui_ImplOpenGL3_Batch cmd;
+                cmd.Scissor[0] = (int)clip_min.x;
+                cmd.Scissor[1] = (int)(fb_height - clip_max.y);
+                cmd.Scissor[2] = (int)(clip_max.x - clip_min.x);
+                cmd.Scissor[3] = (int)(clip_max.y - clip_min.y);
+                cmd.TexId = (GLuint)(intptr_t)pcmd->GetTexID();
+                cmd.IdxOffset = stream_idx_offset + (GLsizeiptr)(list_idx_offset + pcmd->IdxOffset) * (int)sizeof(ImDrawIdx);
+                cmd.ElemCount = (GLsizei)pcmd->ElemCount;
+                cmd.VtxOffset = rebased ? stream_vtx_base : (GLint)(list_vtx_offset + pcmd->VtxOffset);
+
+                // Join the pending batch when the indices follow its own and the command draws the same under its scissor box
+                // (e.g. row backgrounds and column contents that the column clip rects do not actually cut)
+                if (batch_open && bd->DrawOptimizer && cmd.TexId == batch.TexId && cmd.VtxOffset == batch.VtxOffset &&
+                    cmd.IdxOffset == batch.IdxOffset + (GLsizeiptr)batch.ElemCount * (int)sizeof(ImDrawIdx) &&
+                    (memcmp(cmd.Scissor, batch.Scissor, sizeof(cmd.Scissor)) == 0 ||
+                     ImGui_ImplOpenGL3_CmdInsideScissors(cmd_list, pcmd, cmd.Scissor, batch.Scissor, clip_off, clip_scale, fb_height)))
+                {
+                    batch.ElemCount += cmd.ElemCount;
+                    continue;
+                }
+                if (batch_open)
+                    ImGui_ImplOpenGL3_DrawBatch(bd, batch, &applied, &applied_valid);
+                batch = cmd;
+                batch_open = true;
             }
         }
+        if (stream)
+        {
+            list_vtx_offset += cmd_list->VtxBuffer.Size;
+            list_idx_offset += cmd_list->IdxBuffer.Size;
+        }
+        else if (batch_open)
+        {
+            // The next list's upload replaces the buffers
+            ImGui_ImplOpenGL3_DrawBatch(bd, batch, &applied, &applied_valid);
+            batch_open = false;
+        }
     }
+    if (batch_open)
+        ImGui_ImplOpenGL3_DrawBatch(bd, batch, &applied, &applied_valid);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFERS
+    if (stream)
+        ImGui_ImplOpenGL3_StreamFence(bd);
+#endif
 
     // Destroy the temporary VAO
 #ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
@@ -553,6 +914,35 @@ void ImGui_ImplOpenGL3_DestroyFontsTexture()
     }
 }
 
+void ImGui_ImplOpenGL3_SetFontTextureSdf(bool sdf)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != NULL && "Did you call ImGui_ImplOpenGL3_Init()?");
+    bd->FontTextureSdf = sdf;
+}
+
+void ImGui_ImplOpenGL3_SetStreamMode(int mode)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != NULL && "Did you call ImGui_ImplOpenGL3_Init()?");
+    IM_ASSERT(mode >= ImGui_ImplOpenGL3_StreamMode_BufferData && mode <= ImGui_ImplOpenGL3_StreamMode_Persistent);
+    bd->StreamMode = mode;
+}
+
+void ImGui_ImplOpenGL3_GetRenderStats(ImGui_ImplOpenGL3_RenderStats* out_stats)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != NULL && "Did you call ImGui_ImplOpenGL3_Init()?");
+    *out_stats = bd->Stats;
+}
+
+void ImGui_ImplOpenGL3_SetDrawOptimizer(bool enabled)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != NULL && "Did you call ImGui_ImplOpenGL3_Init()?");
+    bd->DrawOptimizer = enabled;
+}
+
 // If you get an error please report on github. You may try different GL context version or GLSL version. See GL<>GLSL version table at the top of this file.
 static bool CheckShader(GLuint handle, const char* desc)
 {
@@ -665,47 +1055,67 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
         "    gl_Position = ProjMtx * vec4(Position.xy,0,1);\n"
         "}\n";
 
+    // FontSdf != 0: alpha is a distance field with the edge at 0.5, antialiased over one screen pixel.
+    // Solid texels (white pixel, cursors) are 0 or 1 and come out unchanged. fwidth() is taken outside
+    // of any branch, derivatives are undefined in non-uniform control flow.
     const GLchar* fragment_shader_glsl_120 =
         "#ifdef GL_ES\n"
+        "    #extension GL_OES_standard_derivatives : enable\n"
         "    precision mediump float;\n"
         "#endif\n"
         "uniform sampler2D Texture;\n"
+        "uniform int FontSdf;\n"
         "varying vec2 Frag_UV;\n"
         "varying vec4 Frag_Color;\n"
         "void main()\n"
         "{\n"
-        "    gl_FragColor = Frag_Color * texture2D(Texture, Frag_UV.st);\n"
+        "    vec4 tex = texture2D(Texture, Frag_UV.st);\n"
+        "    float w = max(0.5 * fwidth(tex.a), 1.0 / 255.0);\n"
+        "    float sdf = smoothstep(0.5 - w, 0.5 + w, tex.a);\n"
+        "    gl_FragColor = Frag_Color * vec4(tex.rgb, FontSdf != 0 ? sdf : tex.a);\n"
         "}\n";
 
     const GLchar* fragment_shader_glsl_130 =
         "uniform sampler2D Texture;\n"
+        "uniform int FontSdf;\n"
         "in vec2 Frag_UV;\n"
         "in vec4 Frag_Color;\n"
         "out vec4 Out_Color;\n"
         "void main()\n"
         "{\n"
-        "    Out_Color = Frag_Color * texture(Texture, Frag_UV.st);\n"
+        "    vec4 tex = texture(Texture, Frag_UV.st);\n"
+        "    float w = max(0.5 * fwidth(tex.a), 1.0 / 255.0);\n"
+        "    float sdf = smoothstep(0.5 - w, 0.5 + w, tex.a);\n"
+        "    Out_Color = Frag_Color * vec4(tex.rgb, FontSdf != 0 ? sdf : tex.a);\n"
         "}\n";
 
     const GLchar* fragment_shader_glsl_300_es =
         "precision mediump float;\n"
         "uniform sampler2D Texture;\n"
+        "uniform int FontSdf;\n"
         "in vec2 Frag_UV;\n"
         "in vec4 Frag_Color;\n"
         "layout (location = 0) out vec4 Out_Color;\n"
         "void main()\n"
         "{\n"
-        "    Out_Color = Frag_Color * texture(Texture, Frag_UV.st);\n"
+        "    vec4 tex = texture(Texture, Frag_UV.st);\n"
+        "    float w = max(0.5 * fwidth(tex.a), 1.0 / 255.0);\n"
+        "    float sdf = smoothstep(0.5 - w, 0.5 + w, tex.a);\n"
+        "    Out_Color = Frag_Color * vec4(tex.rgb, FontSdf != 0 ? sdf : tex.a);\n"
         "}\n";
 
     const GLchar* fragment_shader_glsl_410_core =
         "in vec2 Frag_UV;\n"
         "in vec4 Frag_Color;\n"
         "uniform sampler2D Texture;\n"
+        "uniform int FontSdf;\n"
         "layout (location = 0) out vec4 Out_Color;\n"
         "void main()\n"
         "{\n"
-        "    Out_Color = Frag_Color * texture(Texture, Frag_UV.st);\n"
+        "    vec4 tex = texture(Texture, Frag_UV.st);\n"
+        "    float w = max(0.5 * fwidth(tex.a), 1.0 / 255.0);\n"
+        "    float sdf = smoothstep(0.5 - w, 0.5 + w, tex.a);\n"
+        "    Out_Color = Frag_Color * vec4(tex.rgb, FontSdf != 0 ? sdf : tex.a);\n"
         "}\n";
 
     // Select shaders matching our GLSL versions
@@ -759,6 +1169,7 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
 
     bd->AttribLocationTex = glGetUniformLocation(bd->ShaderHandle, "Texture");
     bd->AttribLocationProjMtx = glGetUniformLocation(bd->ShaderHandle, "ProjMtx");
+    bd->AttribLocationFontSdf = glGetUniformLocation(bd->ShaderHandle, "FontSdf");
     bd->AttribLocationVtxPos = (GLuint)glGetAttribLocation(bd->ShaderHandle, "Position");
     bd->AttribLocationVtxUV = (GLuint)glGetAttribLocation(bd->ShaderHandle, "UV");
     bd->AttribLocationVtxColor = (GLuint)glGetAttribLocation(bd->ShaderHandle, "Color");
@@ -766,6 +1177,7 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
     // Create buffers
     glGenBuffers(1, &bd->VboHandle);
     glGenBuffers(1, &bd->ElementsHandle);
+    bd->StreamModeActive = ImGui_ImplOpenGL3_StreamMode_BufferData;
 
     ImGui_ImplOpenGL3_CreateFontsTexture();
 
@@ -782,6 +1194,12 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
 void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
 {
     ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_STREAM_BUFFERS
+    for (int i = 0; i < IMGUI_IMPL_OPENGL_STREAM_SECTIONS; i++)
+        if (bd->StreamFences[i]) { glDeleteSync(bd->StreamFences[i]); bd->StreamFences[i] = NULL; }
+#endif
+    bd->StreamVtxSize = bd->StreamIdxSize = 0;
+    bd->StreamVtxMapped = bd->StreamIdxMapped = NULL;
     if (bd->VboHandle)      { glDeleteBuffers(1, &bd->VboHandle); bd->VboHandle = 0; }
     if (bd->ElementsHandle) { glDeleteBuffers(1, &bd->ElementsHandle); bd->ElementsHandle = 0; }
     if (bd->ShaderHandle)   { glDeleteProgram(bd->ShaderHandle); bd->ShaderHandle = 0; }
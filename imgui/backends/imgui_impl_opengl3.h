@@ -33,6 +33,38 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 
+// (Optional) The font texture holds signed distance fields (e.g. built with ImGuiFreeTypeBuilderFlags_SDF): threshold its alpha at 0.5 when drawing.
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetFontTextureSdf(bool sdf);
+
+// (Optional) How vertex/index data reaches the GL, can be changed between frames. Streaming modes need GL 3.2+ (base vertex) and fall back to BufferData otherwise.
+enum ImGui_ImplOpenGL3_StreamMode_
+{
+    ImGui_ImplOpenGL3_StreamMode_BufferData = 0,    // glBufferData() for every draw list (default)
+    ImGui_ImplOpenGL3_StreamMode_MapRange   = 1,    // All draw lists of a frame packed into one ring buffer with glMapBufferRange(UNSYNCHRONIZED), orphaned when it wraps
+    ImGui_ImplOpenGL3_StreamMode_Persistent = 2     // Persistently mapped ring of 3 fenced sections (GL 4.4+ or ARB_buffer_storage), else MapRange
+};
+
+// Counters since ImGui_ImplOpenGL3_Init(). Read them from the thread calling ImGui_ImplOpenGL3_RenderDrawData().
+struct ImGui_ImplOpenGL3_RenderStats
+{
+    ImU64   BytesUploaded;      // Vertex + index bytes handed to the GL
+    ImU32   BufferAllocs;       // Buffer storage allocations: glBufferData() calls, ring (re)creations and orphaning
+    ImU32   MapStalls;          // Persistent: sections the CPU had to wait for. MapRange: failed maps/unmaps (frame redone with glBufferData)
+    ImU64   DrawCmds;           // Visible ImDrawCmd submitted (one draw call each without the draw optimizer)
+    ImU64   DrawCalls;          // glDrawElements*() calls issued for them
+    int     ActiveMode;         // ImGui_ImplOpenGL3_StreamMode_ used by the last ImGui_ImplOpenGL3_RenderDrawData()
+};
+
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetStreamMode(int mode);
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_GetRenderStats(ImGui_ImplOpenGL3_RenderStats* out_stats);
+
+// (Optional) Draw optimizer: consecutive commands with the same texture and contiguous indices are drawn with one call when they have the
+// same scissor box in framebuffer pixels, or when every vertex of the command lies inside both its own box and the batch's: the clip rect
+// then cuts nothing and the batch keeps its box (e.g. per-row DrawBackground() rectangles and column contents of a table or property
+// inspector). glScissor()/glBindTexture() are skipped when they would not change anything. Commands of different draw lists are merged only
+// in the streaming modes, where the frame's indices are rebased into one vertex range (needs 32-bit ImDrawIdx or a frame under 64k vertices).
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetDrawOptimizer(bool enabled);
+
 // Specific OpenGL ES versions
 //#define IMGUI_IMPL_OPENGL_ES2     // Auto-detected on Emscripten
 //#define IMGUI_IMPL_OPENGL_ES3     // Auto-detected on iOS/Android
@@ -249,11 +249,13 @@ typedef void (APIENTRYP PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
 typedef void (APIENTRYP PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint *buffers);
 typedef void (APIENTRYP PFNGLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
 typedef void (APIENTRYP PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+typedef GLboolean (APIENTRYP PFNGLUNMAPBUFFERPROC) (GLenum target);
 #ifdef GL_GLEXT_PROTOTYPES
 GLAPI void APIENTRY glBindBuffer (GLenum target, GLuint buffer);
 GLAPI void APIENTRY glDeleteBuffers (GLsizei n, const GLuint *buffers);
 GLAPI void APIENTRY glGenBuffers (GLsizei n, GLuint *buffers);
 GLAPI void APIENTRY glBufferData (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+GLAPI GLboolean APIENTRY glUnmapBuffer (GLenum target);
 #endif
 #endif /* GL_VERSION_1_5 */
 #ifndef GL_VERSION_2_0
@@ -322,14 +324,20 @@ typedef khronos_uint16_t GLhalf;
 #define GL_NUM_EXTENSIONS                 0x821D
 #define GL_FRAMEBUFFER_SRGB               0x8DB9
 #define GL_VERTEX_ARRAY_BINDING           0x85B5
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT       0x0004
+#define GL_MAP_INVALIDATE_BUFFER_BIT      0x0008
+#define GL_MAP_UNSYNCHRONIZED_BIT         0x0020
 typedef void (APIENTRYP PFNGLGETBOOLEANI_VPROC) (GLenum target, GLuint index, GLboolean *data);
 typedef void (APIENTRYP PFNGLGETINTEGERI_VPROC) (GLenum target, GLuint index, GLint *data);
 typedef const GLubyte *(APIENTRYP PFNGLGETSTRINGIPROC) (GLenum name, GLuint index);
+typedef void *(APIENTRYP PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
 typedef void (APIENTRYP PFNGLBINDVERTEXARRAYPROC) (GLuint array);
 typedef void (APIENTRYP PFNGLDELETEVERTEXARRAYSPROC) (GLsizei n, const GLuint *arrays);
 typedef void (APIENTRYP PFNGLGENVERTEXARRAYSPROC) (GLsizei n, GLuint *arrays);
 #ifdef GL_GLEXT_PROTOTYPES
 GLAPI const GLubyte *APIENTRY glGetStringi (GLenum name, GLuint index);
+GLAPI void *APIENTRY glMapBufferRange (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
 GLAPI void APIENTRY glBindVertexArray (GLuint array);
 GLAPI void APIENTRY glDeleteVertexArrays (GLsizei n, const GLuint *arrays);
 GLAPI void APIENTRY glGenVertexArrays (GLsizei n, GLuint *arrays);
@@ -344,10 +352,22 @@ GLAPI void APIENTRY glGenVertexArrays (GLsizei n, GLuint *arrays);
 typedef struct __GLsync *GLsync;
 typedef khronos_uint64_t GLuint64;
 typedef khronos_int64_t GLint64;
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_ALREADY_SIGNALED               0x911A
+#define GL_TIMEOUT_EXPIRED                0x911B
+#define GL_CONDITION_SATISFIED            0x911C
+#define GL_WAIT_FAILED                    0x911D
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
 typedef void (APIENTRYP PFNGLDRAWELEMENTSBASEVERTEXPROC) (GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex);
 typedef void (APIENTRYP PFNGLGETINTEGER64I_VPROC) (GLenum target, GLuint index, GLint64 *data);
+typedef GLsync (APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef void (APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+typedef GLenum (APIENTRYP PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
 #ifdef GL_GLEXT_PROTOTYPES
 GLAPI void APIENTRY glDrawElementsBaseVertex (GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex);
+GLAPI GLsync APIENTRY glFenceSync (GLenum condition, GLbitfield flags);
+GLAPI void APIENTRY glDeleteSync (GLsync sync);
+GLAPI GLenum APIENTRY glClientWaitSync (GLsync sync, GLbitfield flags, GLuint64 timeout);
 #endif
 #endif /* GL_VERSION_3_2 */
 #ifndef GL_VERSION_3_3
@@ -365,6 +385,15 @@ typedef void (APIENTRYP PFNGLGETDOUBLEI_VPROC) (GLenum target, GLuint index, GLd
 #ifndef GL_VERSION_4_3
 typedef void (APIENTRY  *GLDEBUGPROC)(GLenum source,GLenum type,GLuint id,GLenum severity,GLsizei length,const GLchar *message,const void *userParam);
 #endif /* GL_VERSION_4_3 */
+#ifndef GL_VERSION_4_4
+#define GL_VERSION_4_4 1
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#ifdef GL_GLEXT_PROTOTYPES
+GLAPI void APIENTRY glBufferStorage (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#endif
+#endif /* GL_VERSION_4_4 */
 #ifndef GL_VERSION_4_5
 #define GL_CLIP_ORIGIN                    0x935C
 typedef void (APIENTRYP PFNGLGETTRANSFORMFEEDBACKI_VPROC) (GLuint xfb, GLenum pname, GLuint index, GLint *param);
@@ -435,7 +464,7 @@ GL3W_API GL3WglProc imgl3wGetProcAddress(const char *proc);
 
 /* gl3w internal state */
 union GL3WProcs {
-    GL3WglProc ptr[53];
+    GL3WglProc ptr[59];
     struct {
         PFNGLACTIVETEXTUREPROC           ActiveTexture;
         PFNGLATTACHSHADERPROC            AttachShader;
@@ -447,14 +476,17 @@ union GL3WProcs {
         PFNGLBLENDEQUATIONSEPARATEPROC   BlendEquationSeparate;
         PFNGLBLENDFUNCSEPARATEPROC       BlendFuncSeparate;
         PFNGLBUFFERDATAPROC              BufferData;
+        PFNGLBUFFERSTORAGEPROC           BufferStorage;
         PFNGLCLEARPROC                   Clear;
         PFNGLCLEARCOLORPROC              ClearColor;
+        PFNGLCLIENTWAITSYNCPROC          ClientWaitSync;
         PFNGLCOMPILESHADERPROC           CompileShader;
         PFNGLCREATEPROGRAMPROC           CreateProgram;
         PFNGLCREATESHADERPROC            CreateShader;
         PFNGLDELETEBUFFERSPROC           DeleteBuffers;
         PFNGLDELETEPROGRAMPROC           DeleteProgram;
         PFNGLDELETESHADERPROC            DeleteShader;
+        PFNGLDELETESYNCPROC              DeleteSync;
         PFNGLDELETETEXTURESPROC          DeleteTextures;
         PFNGLDELETEVERTEXARRAYSPROC      DeleteVertexArrays;
         PFNGLDETACHSHADERPROC            DetachShader;
@@ -463,6 +495,7 @@ union GL3WProcs {
         PFNGLDRAWELEMENTSBASEVERTEXPROC  DrawElementsBaseVertex;
         PFNGLENABLEPROC                  Enable;
         PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray;
+        PFNGLFENCESYNCPROC               FenceSync;
         PFNGLGENBUFFERSPROC              GenBuffers;
         PFNGLGENTEXTURESPROC             GenTextures;
         PFNGLGENVERTEXARRAYSPROC         GenVertexArrays;
@@ -478,6 +511,7 @@ union GL3WProcs {
         PFNGLGETUNIFORMLOCATIONPROC      GetUniformLocation;
         PFNGLISENABLEDPROC               IsEnabled;
         PFNGLLINKPROGRAMPROC             LinkProgram;
+        PFNGLMAPBUFFERRANGEPROC          MapBufferRange;
         PFNGLPIXELSTOREIPROC             PixelStorei;
         PFNGLPOLYGONMODEPROC             PolygonMode;
         PFNGLREADPIXELSPROC              ReadPixels;
@@ -487,6 +521,7 @@ union GL3WProcs {
         PFNGLTEXPARAMETERIPROC           TexParameteri;
         PFNGLUNIFORM1IPROC               Uniform1i;
         PFNGLUNIFORMMATRIX4FVPROC        UniformMatrix4fv;
+        PFNGLUNMAPBUFFERPROC             UnmapBuffer;
         PFNGLUSEPROGRAMPROC              UseProgram;
         PFNGLVERTEXATTRIBPOINTERPROC     VertexAttribPointer;
         PFNGLVIEWPORTPROC                Viewport;
@@ -506,14 +541,17 @@ GL3W_API extern union GL3WProcs imgl3wProcs;
 #define glBlendEquationSeparate          imgl3wProcs.gl.BlendEquationSeparate
 #define glBlendFuncSeparate              imgl3wProcs.gl.BlendFuncSeparate
 #define glBufferData                     imgl3wProcs.gl.BufferData
+#define glBufferStorage                  imgl3wProcs.gl.BufferStorage
 #define glClear                          imgl3wProcs.gl.Clear
 #define glClearColor                     imgl3wProcs.gl.ClearColor
+#define glClientWaitSync                 imgl3wProcs.gl.ClientWaitSync
 #define glCompileShader                  imgl3wProcs.gl.CompileShader
 #define glCreateProgram                  imgl3wProcs.gl.CreateProgram
 #define glCreateShader                   imgl3wProcs.gl.CreateShader
 #define glDeleteBuffers                  imgl3wProcs.gl.DeleteBuffers
 #define glDeleteProgram                  imgl3wProcs.gl.DeleteProgram
 #define glDeleteShader                   imgl3wProcs.gl.DeleteShader
+#define glDeleteSync                     imgl3wProcs.gl.DeleteSync
 #define glDeleteTextures                 imgl3wProcs.gl.DeleteTextures
 #define glDeleteVertexArrays             imgl3wProcs.gl.DeleteVertexArrays
 #define glDetachShader                   imgl3wProcs.gl.DetachShader
@@ -522,6 +560,7 @@ GL3W_API extern union GL3WProcs imgl3wProcs;
 #define glDrawElementsBaseVertex         imgl3wProcs.gl.DrawElementsBaseVertex
 #define glEnable                         imgl3wProcs.gl.Enable
 #define glEnableVertexAttribArray        imgl3wProcs.gl.EnableVertexAttribArray
+#define glFenceSync                      imgl3wProcs.gl.FenceSync
 #define glGenBuffers                     imgl3wProcs.gl.GenBuffers
 #define glGenTextures                    imgl3wProcs.gl.GenTextures
 #define glGenVertexArrays                imgl3wProcs.gl.GenVertexArrays
@@ -537,6 +576,7 @@ GL3W_API extern union GL3WProcs imgl3wProcs;
 #define glGetUniformLocation             imgl3wProcs.gl.GetUniformLocation
 #define glIsEnabled                      imgl3wProcs.gl.IsEnabled
 #define glLinkProgram                    imgl3wProcs.gl.LinkProgram
+#define glMapBufferRange                 imgl3wProcs.gl.MapBufferRange
 #define glPixelStorei                    imgl3wProcs.gl.PixelStorei
 #define glPolygonMode                    imgl3wProcs.gl.PolygonMode
 #define glReadPixels                     imgl3wProcs.gl.ReadPixels
@@ -546,6 +586,7 @@ GL3W_API extern union GL3WProcs imgl3wProcs;
 #define glTexParameteri                  imgl3wProcs.gl.TexParameteri
 #define glUniform1i                      imgl3wProcs.gl.Uniform1i
 #define glUniformMatrix4fv               imgl3wProcs.gl.UniformMatrix4fv
+#define glUnmapBuffer                    imgl3wProcs.gl.UnmapBuffer
 #define glUseProgram                     imgl3wProcs.gl.UseProgram
 #define glVertexAttribPointer            imgl3wProcs.gl.VertexAttribPointer
 #define glViewport                       imgl3wProcs.gl.Viewport
@@ -692,14 +733,17 @@ static const char *proc_names[] = {
     "glBlendEquationSeparate",
     "glBlendFuncSeparate",
     "glBufferData",
+    "glBufferStorage",
     "glClear",
     "glClearColor",
+    "glClientWaitSync",
     "glCompileShader",
     "glCreateProgram",
     "glCreateShader",
     "glDeleteBuffers",
     "glDeleteProgram",
     "glDeleteShader",
+    "glDeleteSync",
     "glDeleteTextures",
     "glDeleteVertexArrays",
     "glDetachShader",
@@ -708,6 +752,7 @@ static const char *proc_names[] = {
     "glDrawElementsBaseVertex",
     "glEnable",
     "glEnableVertexAttribArray",
+    "glFenceSync",
     "glGenBuffers",
     "glGenTextures",
     "glGenVertexArrays",
@@ -723,6 +768,7 @@ static const char *proc_names[] = {
     "glGetUniformLocation",
     "glIsEnabled",
     "glLinkProgram",
+    "glMapBufferRange",
     "glPixelStorei",
     "glPolygonMode",
     "glReadPixels",
@@ -732,6 +778,7 @@ static const char *proc_names[] = {
     "glTexParameteri",
     "glUniform1i",
     "glUniformMatrix4fv",
+    "glUnmapBuffer",
     "glUseProgram",
     "glVertexAttribPointer",
     "glViewport",
@@ -2865,6 +2865,12 @@ struct ImFont
     int                         MetricsTotalSurface;// 4     // out //            // Total surface in pixels to get an idea of the font rasterization/texture cost (not exact, we approximate the cost of padding between glyphs)
     ImU8                        Used4kPagesMap[(IM_UNICODE_CODEPOINT_MAX+1)/4096/8]; // 2 bytes if ImWchar=ImWchar16, 34 bytes if ImWchar==ImWchar32. Store 1-bit for each block of 4K codepoints that has one active glyph. This is mainly used to facilitate iterations across all used codepoints.
 
+    // Members: Fonts filled on demand (NULL for fonts fully built by ImFontAtlas::Build())
+    void                        (*MissingGlyphCallback)(const ImFont* font, ImWchar c); // out //  // Called by FindGlyph() before returning FallbackGlyph for 'c'. Use MissingGlyphUserData to find your data.
+    void*                       MissingGlyphUserData;   // out //
+    ImU32*                      GlyphUseFrames;     // out //            // Parallel to Glyphs[]: FindGlyph() stores GlyphUseFrame there, to find least recently used glyphs.
+    ImU32                       GlyphUseFrame;      // out //
+
     // Methods
     IMGUI_API ImFont();
     IMGUI_API ~ImFont();
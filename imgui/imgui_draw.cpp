@@ -3117,6 +3117,10 @@ ImFont::ImFont()
     Ascent = Descent = 0.0f;
     MetricsTotalSurface = 0;
     memset(Used4kPagesMap, 0, sizeof(Used4kPagesMap));
+    MissingGlyphCallback = NULL;
+    MissingGlyphUserData = NULL;
+    GlyphUseFrames = NULL;
+    GlyphUseFrame = 0;
 }
 
 ImFont::~ImFont()
@@ -3136,6 +3140,9 @@ void    ImFont::ClearOutputData()
     DirtyLookupTables = true;
     Ascent = Descent = 0.0f;
     MetricsTotalSurface = 0;
+    MissingGlyphCallback = NULL;
+    MissingGlyphUserData = NULL;
+    GlyphUseFrames = NULL;
 }
 
 static ImWchar FindFirstExistingGlyph(ImFont* font, const ImWchar* candidate_chars, int candidate_chars_count)
@@ -3310,11 +3317,15 @@ void ImFont::AddRemapChar(ImWchar dst, ImWchar src, bool overwrite_dst)
 
 const ImFontGlyph* ImFont::FindGlyph(ImWchar c) const
 {
-    if (c >= (size_t)IndexLookup.Size)
-        return FallbackGlyph;
-    const ImWchar i = IndexLookup.Data[c];
+    const ImWchar i = (c < (size_t)IndexLookup.Size) ? IndexLookup.Data[c] : (ImWchar)-1;
     if (i == (ImWchar)-1)
+    {
+        if (MissingGlyphCallback)
+            MissingGlyphCallback(this, c);
         return FallbackGlyph;
+    }
+    if (GlyphUseFrames)
+        GlyphUseFrames[i] = GlyphUseFrame;
     return &Glyphs.Data[i];
 }
 
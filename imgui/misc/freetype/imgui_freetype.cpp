@@ -35,6 +35,9 @@
 #include "imgui_freetype.h"
 #include "imgui_internal.h"     // ImMin,ImMax,ImFontAtlasBuild*,
 #include <stdint.h>
+#include <stdlib.h>             // malloc, free
+#include <atomic>               // std::atomic (parallel build)
+#include <thread>               // std::thread (parallel build)
 #include <ft2build.h>
 #include FT_FREETYPE_H          // <freetype/freetype.h>
 #include FT_MODULE_H            // <freetype/ftmodapi.h>
@@ -64,6 +67,9 @@ static void* (*GImGuiFreeTypeAllocFunc)(size_t size, void* user_data) = ImGuiFre
 static void  (*GImGuiFreeTypeFreeFunc)(void* ptr, void* user_data) = ImGuiFreeTypeDefaultFreeFunc;
 static void* GImGuiFreeTypeAllocatorUserData = NULL;
 
+// Threads rasterizing glyphs in ImFontAtlasBuildWithFreeTypeEx(), 0 = one per hardware thread
+static int GImGuiFreeTypeBuildThreadCount = 0;
+
 //-------------------------------------------------------------------------
 // Code
 //-------------------------------------------------------------------------
@@ -175,7 +181,15 @@ namespace
         else
             LoadFlags |= FT_LOAD_TARGET_NORMAL;
 
-        if (UserFlags & ImGuiFreeTypeBuilderFlags_Monochrome)
+        if (UserFlags & ImGuiFreeTypeBuilderFlags_SDF)
+        {
+            // The spread is a property of the renderer modules, so of the whole FT_Library: every SDF font uses the same one.
+            FT_Int spread = IMGUI_FREETYPE_SDF_SPREAD;
+            FT_Property_Set(ft_library, "sdf", "spread", &spread);
+            FT_Property_Set(ft_library, "bsdf", "spread", &spread);
+            RenderMode = FT_RENDER_MODE_SDF;
+        }
+        else if (UserFlags & ImGuiFreeTypeBuilderFlags_Monochrome)
             RenderMode = FT_RENDER_MODE_MONO;
         else
             RenderMode = FT_RENDER_MODE_NORMAL;
@@ -253,6 +267,8 @@ namespace
     {
         FT_GlyphSlot slot = Face->glyph;
         FT_Error error = FT_Render_Glyph(slot, RenderMode);
+        if (error != 0 && RenderMode == FT_RENDER_MODE_SDF)
+            error = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL); // The SDF renderers reject empty outlines (e.g. space), keep them as empty bitmaps
         if (error != 0)
             return NULL;
 
@@ -360,7 +376,7 @@ struct ImFontBuildSrcGlyphFT
 {
     GlyphInfo           Info;
     uint32_t            Codepoint;
-    unsigned int*       BitmapData;         // Point within one of the dst_tmp_bitmap_buffers[] array
+    unsigned int*       BitmapData;         // Point within one of the ImFontBuildWorkerFT::BitmapChunk buffers
 
     ImFontBuildSrcGlyphFT() { memset(this, 0, sizeof(*this)); }
 };
@@ -375,6 +391,8 @@ struct ImFontBuildSrcDataFT
     int                 GlyphsCount;        // Glyph count (excluding missing glyphs and glyphs already set by an earlier source font)
     ImBitVector         GlyphsSet;          // Glyph bit map (random access, 1-bit per codepoint. This will be a maximum of 8KB)
     ImVector<ImFontBuildSrcGlyphFT>   GlyphsList;
+    bool                MultiplyEnabled;
+    unsigned char       MultiplyTable[256];
 };
 
 // Temporary data for one destination ImFont* (multiple source fonts can be merged into one destination ImFont)
@@ -386,6 +404,121 @@ struct ImFontBuildDstDataFT
     ImBitVector         GlyphsSet;          // This is used to resolve collision when multiple sources are merged into a same destination font.
 };
 
+// One glyph to rasterize. Workers take jobs in chunks of IMGUI_FREETYPE_BUILD_JOBS_CHUNK.
+struct ImFontBuildJobFT
+{
+    int                 SrcIndex;
+    int                 GlyphIndex;
+};
+
+#define IMGUI_FREETYPE_BUILD_JOBS_CHUNK         32
+#define IMGUI_FREETYPE_BUILD_JOBS_PER_THREAD    256         // Don't start a thread for less than this many glyphs
+#define IMGUI_FREETYPE_BUILD_BITMAP_CHUNK_SIZE  (256 * 1024)
+
+// Read-only inputs of the rasterization step, shared by all workers.
+struct ImFontBuildSharedFT
+{
+    ImFontAtlas*                        Atlas;
+    ImVector<ImFontBuildSrcDataFT>*     SrcTmpArray;
+    const ImVector<ImFontBuildJobFT>*   Jobs;
+    unsigned int                        ExtraFlags;
+    std::atomic<int>                    NextJob;
+};
+
+// Per-thread state of the rasterization step.
+// - FreeType objects can't be shared between threads: the calling thread uses ImFontBuildSrcDataFT::Font,
+//   the other workers open their own FT_Library and FT_Face on first use.
+// - Workers allocate with malloc(): neither IM_ALLOC() nor the SetAllocatorFunctions() ones are required to be thread-safe.
+struct ImFontBuildWorkerFT
+{
+    bool                    IsCallingThread;
+    FT_Library              Library;
+    ImVector<FreeTypeFont>  Fonts;              // [src_i], zero-cleared by the calling thread
+    ImVector<int>           FontsState;         // [src_i], 0: not opened, 1: ready, -1: failed
+    unsigned char*          BitmapChunk;        // Current chunk. The first bytes of each chunk point to the previous one.
+    int                     BitmapChunkUsed;
+    int                     TotalSurface;
+};
+
+static FreeTypeFont* ImFontBuildWorkerGetFontFT(ImFontBuildWorkerFT* worker, ImFontBuildSharedFT* shared, int src_i)
+{
+    if (worker->IsCallingThread)
+        return &(*shared->SrcTmpArray)[src_i].Font;
+    if (worker->FontsState[src_i] == 0)
+    {
+        if (worker->Library == NULL && FT_Init_FreeType(&worker->Library) != 0)
+            worker->Library = NULL;
+        bool ok = worker->Library != NULL && worker->Fonts[src_i].InitFont(worker->Library, shared->Atlas->ConfigData[src_i], shared->ExtraFlags);
+        worker->FontsState[src_i] = ok ? 1 : -1;
+    }
+    return (worker->FontsState[src_i] == 1) ? &worker->Fonts[src_i] : NULL;
+}
+
+// 4. Gather glyphs sizes so we can pack them in our virtual canvas.
+// 8. Render/rasterize font characters into the texture
+// Every job writes only its own GlyphsList[] and Rects[] entries, so the result doesn't depend on the thread count.
+static void ImFontBuildRasterizeGlyphsFT(ImFontBuildWorkerFT* worker, ImFontBuildSharedFT* shared)
+{
+    ImVector<ImFontBuildSrcDataFT>& src_tmp_array = *shared->SrcTmpArray;
+    const int padding = shared->Atlas->TexGlyphPadding;
+    const int jobs_count = shared->Jobs->Size;
+    for (;;)
+    {
+        const int job_begin = shared->NextJob.fetch_add(IMGUI_FREETYPE_BUILD_JOBS_CHUNK);
+        if (job_begin >= jobs_count)
+            break;
+        const int job_end = ImMin(job_begin + IMGUI_FREETYPE_BUILD_JOBS_CHUNK, jobs_count);
+        for (int job_i = job_begin; job_i < job_end; job_i++)
+        {
+            const ImFontBuildJobFT& job = (*shared->Jobs)[job_i];
+            ImFontBuildSrcDataFT& src_tmp = src_tmp_array[job.SrcIndex];
+            ImFontBuildSrcGlyphFT& src_glyph = src_tmp.GlyphsList[job.GlyphIndex];
+            FreeTypeFont* font = ImFontBuildWorkerGetFontFT(worker, shared, job.SrcIndex);
+            if (font == NULL)
+                continue;
+
+            const FT_Glyph_Metrics* metrics = font->LoadGlyph(src_glyph.Codepoint);
+            if (metrics == NULL)
+                continue;
+
+            // Render glyph into a bitmap (currently held by FreeType)
+            const FT_Bitmap* ft_bitmap = font->RenderGlyphAndGetInfo(&src_glyph.Info);
+            if (ft_bitmap == NULL)
+                continue;
+
+            // Allocate new temporary chunk if needed
+            const int bitmap_size_in_bytes = src_glyph.Info.Width * src_glyph.Info.Height * 4;
+            if (worker->BitmapChunk == NULL || worker->BitmapChunkUsed + bitmap_size_in_bytes > IMGUI_FREETYPE_BUILD_BITMAP_CHUNK_SIZE)
+            {
+                unsigned char* chunk = (unsigned char*)malloc(IMGUI_FREETYPE_BUILD_BITMAP_CHUNK_SIZE);
+                IM_ASSERT(chunk != NULL);
+                *(unsigned char**)chunk = worker->BitmapChunk;
+                worker->BitmapChunk = chunk;
+                worker->BitmapChunkUsed = 16; // Keep the pixels 16-byte aligned after the link
+            }
+
+            // Blit rasterized pixels to our temporary buffer and keep a pointer to it.
+            src_glyph.BitmapData = (unsigned int*)(worker->BitmapChunk + worker->BitmapChunkUsed);
+            worker->BitmapChunkUsed += bitmap_size_in_bytes;
+            font->BlitGlyph(ft_bitmap, src_glyph.BitmapData, src_glyph.Info.Width, src_tmp.MultiplyEnabled ? src_tmp.MultiplyTable : NULL);
+
+            src_tmp.Rects[job.GlyphIndex].w = (stbrp_coord)(src_glyph.Info.Width + padding);
+            src_tmp.Rects[job.GlyphIndex].h = (stbrp_coord)(src_glyph.Info.Height + padding);
+            worker->TotalSurface += src_tmp.Rects[job.GlyphIndex].w * src_tmp.Rects[job.GlyphIndex].h;
+        }
+    }
+
+    if (!worker->IsCallingThread)
+    {
+        for (int src_i = 0; src_i < worker->FontsState.Size; src_i++)
+            if (worker->FontsState[src_i] != 0)
+                worker->Fonts[src_i].CloseFont();
+        if (worker->Library != NULL)
+            FT_Done_FreeType(worker->Library);
+        worker->Library = NULL;
+    }
+}
+
 bool ImFontAtlasBuildWithFreeTypeEx(FT_Library ft_library, ImFontAtlas* atlas, unsigned int extra_flags)
 {
     IM_ASSERT(atlas->ConfigData.Size > 0);
@@ -499,18 +632,12 @@ bool ImFontAtlasBuildWithFreeTypeEx(FT_Library ft_library, ImFontAtlas* atlas, u
     buf_rects.resize(total_glyphs_count);
     memset(buf_rects.Data, 0, (size_t)buf_rects.size_in_bytes());
 
-    // Allocate temporary rasterization data buffers.
+    // List the glyphs to rasterize, one job each.
     // We could not find a way to retrieve accurate glyph size without rendering them.
     // (e.g. slot->metrics->width not always matching bitmap->width, especially considering the Oblique transform)
-    // We allocate in chunks of 256 KB to not waste too much extra memory ahead. Hopefully users of FreeType won't find the temporary allocations.
-    const int BITMAP_BUFFERS_CHUNK_SIZE = 256 * 1024;
-    int buf_bitmap_current_used_bytes = 0;
-    ImVector<unsigned char*> buf_bitmap_buffers;
-    buf_bitmap_buffers.push_back((unsigned char*)IM_ALLOC(BITMAP_BUFFERS_CHUNK_SIZE));
-
-    // 4. Gather glyphs sizes so we can pack them in our virtual canvas.
-    // 8. Render/rasterize font characters into the texture
-    int total_surface = 0;
+    // Workers allocate bitmaps in chunks of 256 KB to not waste too much extra memory ahead. Hopefully users of FreeType won't find the temporary allocations.
+    ImVector<ImFontBuildJobFT> jobs;
+    jobs.reserve(total_glyphs_count);
     int buf_rects_out_n = 0;
     for (int src_i = 0; src_i < src_tmp_array.Size; src_i++)
     {
@@ -523,45 +650,53 @@ bool ImFontAtlasBuildWithFreeTypeEx(FT_Library ft_library, ImFontAtlas* atlas, u
         buf_rects_out_n += src_tmp.GlyphsCount;
 
         // Compute multiply table if requested
-        const bool multiply_enabled = (cfg.RasterizerMultiply != 1.0f);
-        unsigned char multiply_table[256];
-        if (multiply_enabled)
-            ImFontAtlasBuildMultiplyCalcLookupTable(multiply_table, cfg.RasterizerMultiply);
+        src_tmp.MultiplyEnabled = (cfg.RasterizerMultiply != 1.0f) && (src_tmp.Font.UserFlags & ImGuiFreeTypeBuilderFlags_SDF) == 0;
+        if (src_tmp.MultiplyEnabled)
+            ImFontAtlasBuildMultiplyCalcLookupTable(src_tmp.MultiplyTable, cfg.RasterizerMultiply);
 
-        // Gather the sizes of all rectangles we will need to pack
-        const int padding = atlas->TexGlyphPadding;
         for (int glyph_i = 0; glyph_i < src_tmp.GlyphsList.Size; glyph_i++)
         {
-            ImFontBuildSrcGlyphFT& src_glyph = src_tmp.GlyphsList[glyph_i];
-
-            const FT_Glyph_Metrics* metrics = src_tmp.Font.LoadGlyph(src_glyph.Codepoint);
-            if (metrics == NULL)
-                continue;
-
-            // Render glyph into a bitmap (currently held by FreeType)
-            const FT_Bitmap* ft_bitmap = src_tmp.Font.RenderGlyphAndGetInfo(&src_glyph.Info);
-            if (ft_bitmap == NULL)
-                continue;
-
-            // Allocate new temporary chunk if needed
-            const int bitmap_size_in_bytes = src_glyph.Info.Width * src_glyph.Info.Height * 4;
-            if (buf_bitmap_current_used_bytes + bitmap_size_in_bytes > BITMAP_BUFFERS_CHUNK_SIZE)
-            {
-                buf_bitmap_current_used_bytes = 0;
-                buf_bitmap_buffers.push_back((unsigned char*)IM_ALLOC(BITMAP_BUFFERS_CHUNK_SIZE));
-            }
-
-            // Blit rasterized pixels to our temporary buffer and keep a pointer to it.
-            src_glyph.BitmapData = (unsigned int*)(buf_bitmap_buffers.back() + buf_bitmap_current_used_bytes);
-            buf_bitmap_current_used_bytes += bitmap_size_in_bytes;
-            src_tmp.Font.BlitGlyph(ft_bitmap, src_glyph.BitmapData, src_glyph.Info.Width, multiply_enabled ? multiply_table : NULL);
-
-            src_tmp.Rects[glyph_i].w = (stbrp_coord)(src_glyph.Info.Width + padding);
-            src_tmp.Rects[glyph_i].h = (stbrp_coord)(src_glyph.Info.Height + padding);
-            total_surface += src_tmp.Rects[glyph_i].w * src_tmp.Rects[glyph_i].h;
+            ImFontBuildJobFT job = { src_i, glyph_i };
+            jobs.push_back(job);
         }
     }
 
+    // 4. Gather glyphs sizes so we can pack them in our virtual canvas.
+    // 8. Render/rasterize font characters into the texture
+    // The calling thread is worker 0, extra threads only help with large glyph sets.
+    int thread_count = (GImGuiFreeTypeBuildThreadCount > 0) ? GImGuiFreeTypeBuildThreadCount : (int)std::thread::hardware_concurrency();
+    thread_count = ImClamp(thread_count, 1, ImMax(1, jobs.Size / IMGUI_FREETYPE_BUILD_JOBS_PER_THREAD));
+    ImFontBuildSharedFT shared;
+    shared.Atlas = atlas;
+    shared.SrcTmpArray = &src_tmp_array;
+    shared.Jobs = &jobs;
+    shared.ExtraFlags = extra_flags;
+    shared.NextJob = 0;
+    ImVector<ImFontBuildWorkerFT> workers;
+    workers.resize(thread_count);
+    memset((void*)workers.Data, 0, (size_t)workers.size_in_bytes());
+    for (int worker_i = 0; worker_i < thread_count; worker_i++)
+    {
+        ImFontBuildWorkerFT& worker = workers[worker_i];
+        worker.IsCallingThread = (worker_i == 0);
+        if (worker.IsCallingThread)
+            continue;
+        worker.Fonts.resize(src_tmp_array.Size);
+        memset((void*)worker.Fonts.Data, 0, (size_t)worker.Fonts.size_in_bytes());
+        worker.FontsState.resize(src_tmp_array.Size, 0);
+    }
+    std::thread* threads = (thread_count > 1) ? new std::thread[thread_count - 1] : NULL;
+    for (int worker_i = 1; worker_i < thread_count; worker_i++)
+        threads[worker_i - 1] = std::thread(ImFontBuildRasterizeGlyphsFT, &workers[worker_i], &shared);
+    ImFontBuildRasterizeGlyphsFT(&workers[0], &shared);
+    for (int worker_i = 1; worker_i < thread_count; worker_i++)
+        threads[worker_i - 1].join();
+    delete[] threads;
+
+    int total_surface = 0;
+    for (int worker_i = 0; worker_i < thread_count; worker_i++)
+        total_surface += workers[worker_i].TotalSurface;
+
     // We need a width for the skyline algorithm, any width!
     // The exact width doesn't really matter much, but some API/GPU have texture size limitations and increasing width can decrease height.
     // User can override TexDesiredWidth and TexGlyphPadding if they wish, otherwise we use a simple heuristic to select the width based on expected surface.
@@ -691,8 +826,17 @@ bool ImFontAtlasBuildWithFreeTypeEx(FT_Library ft_library, ImFontAtlas* atlas, u
     atlas->TexPixelsUseColors = tex_use_colors;
 
     // Cleanup
-    for (int buf_i = 0; buf_i < buf_bitmap_buffers.Size; buf_i++)
-        IM_FREE(buf_bitmap_buffers[buf_i]);
+    for (int worker_i = 0; worker_i < workers.Size; worker_i++)
+    {
+        ImFontBuildWorkerFT& worker = workers[worker_i];
+        while (unsigned char* chunk = worker.BitmapChunk)
+        {
+            worker.BitmapChunk = *(unsigned char**)chunk;
+            free(chunk);
+        }
+        worker.Fonts.clear();   // Faces closed by the worker, ImVector<> doesn't run destructors
+        worker.FontsState.clear();
+    }
     src_tmp_array.clear_destruct();
 
     ImFontAtlasBuildFinish(atlas);
@@ -765,9 +909,107 @@ const ImFontBuilderIO* ImGuiFreeType::GetBuilderForFreeType()
     return &io;
 }
 
+void ImGuiFreeType::SetBuilderThreadCount(int thread_count)
+{
+    GImGuiFreeTypeBuildThreadCount = thread_count;
+}
+
 void ImGuiFreeType::SetAllocatorFunctions(void* (*alloc_func)(size_t sz, void* user_data), void (*free_func)(void* ptr, void* user_data), void* user_data)
 {
     GImGuiFreeTypeAllocFunc = alloc_func;
     GImGuiFreeTypeFreeFunc = free_func;
     GImGuiFreeTypeAllocatorUserData = user_data;
 }
+
+//-------------------------------------------------------------------------
+// Single glyph rasterization (atlases filled on demand)
+//-------------------------------------------------------------------------
+
+struct ImGuiFreeTypeRasterizer
+{
+    FT_MemoryRec_       MemoryRec;          // FreeType keeps a pointer to it, must outlive Library
+    FT_Library          Library;
+    FreeTypeFont        Font;
+    bool                MultiplyEnabled;
+    unsigned char       MultiplyTable[256];
+    ImVector<uint32_t>  BlitBuffer;         // RGBA output of FreeTypeFont::BlitGlyph(), reused between glyphs
+};
+
+ImGuiFreeTypeRasterizer* ImGuiFreeType::CreateRasterizer(const ImFontConfig* cfg, unsigned int extra_flags)
+{
+    IM_ASSERT(cfg != NULL && cfg->FontData != NULL);
+    ImGuiFreeTypeRasterizer* rasterizer = IM_NEW(ImGuiFreeTypeRasterizer)();
+    memset(&rasterizer->MemoryRec, 0, sizeof(rasterizer->MemoryRec));
+    rasterizer->MemoryRec.alloc = &FreeType_Alloc;
+    rasterizer->MemoryRec.free = &FreeType_Free;
+    rasterizer->MemoryRec.realloc = &FreeType_Realloc;
+    rasterizer->Library = NULL;
+    rasterizer->Font.Face = NULL;
+    if (FT_New_Library(&rasterizer->MemoryRec, &rasterizer->Library) != 0)
+    {
+        rasterizer->Library = NULL;
+        DestroyRasterizer(rasterizer);
+        return NULL;
+    }
+    FT_Add_Default_Modules(rasterizer->Library);
+    if (!rasterizer->Font.InitFont(rasterizer->Library, *cfg, extra_flags))
+    {
+        DestroyRasterizer(rasterizer);
+        return NULL;
+    }
+    rasterizer->MultiplyEnabled = (cfg->RasterizerMultiply != 1.0f) && (rasterizer->Font.UserFlags & ImGuiFreeTypeBuilderFlags_SDF) == 0;
+    if (rasterizer->MultiplyEnabled)
+        ImFontAtlasBuildMultiplyCalcLookupTable(rasterizer->MultiplyTable, cfg->RasterizerMultiply);
+    return rasterizer;
+}
+
+void ImGuiFreeType::DestroyRasterizer(ImGuiFreeTypeRasterizer* rasterizer)
+{
+    if (rasterizer == NULL)
+        return;
+    rasterizer->Font.CloseFont();
+    if (rasterizer->Library != NULL)
+        FT_Done_Library(rasterizer->Library);
+    IM_DELETE(rasterizer);
+}
+
+void ImGuiFreeType::GetRasterizerMetrics(ImGuiFreeTypeRasterizer* rasterizer, float* out_ascent, float* out_descent)
+{
+    IM_ASSERT(rasterizer != NULL);
+    *out_ascent = rasterizer->Font.Info.Ascender;
+    *out_descent = rasterizer->Font.Info.Descender;
+}
+
+bool ImGuiFreeType::HasGlyph(ImGuiFreeTypeRasterizer* rasterizer, ImWchar codepoint)
+{
+    IM_ASSERT(rasterizer != NULL);
+    return FT_Get_Char_Index(rasterizer->Font.Face, codepoint) != 0;
+}
+
+bool ImGuiFreeType::RasterizeGlyph(ImGuiFreeTypeRasterizer* rasterizer, ImWchar codepoint, ImGuiFreeTypeGlyph* out_glyph)
+{
+    IM_ASSERT(rasterizer != NULL && out_glyph != NULL);
+    const FT_Glyph_Metrics* metrics = rasterizer->Font.LoadGlyph(codepoint);
+    if (metrics == NULL)
+        return false;
+    GlyphInfo info;
+    const FT_Bitmap* ft_bitmap = rasterizer->Font.RenderGlyphAndGetInfo(&info);
+    if (ft_bitmap == NULL)
+        return false;
+
+    out_glyph->Width = info.Width;
+    out_glyph->Height = info.Height;
+    out_glyph->OffsetX = (float)info.OffsetX;
+    out_glyph->OffsetY = (float)info.OffsetY;
+    out_glyph->AdvanceX = info.AdvanceX;
+    const int pixel_count = info.Width * info.Height;
+    out_glyph->Pixels.resize(pixel_count);
+    if (pixel_count == 0)
+        return true;
+
+    rasterizer->BlitBuffer.resize(pixel_count);
+    rasterizer->Font.BlitGlyph(ft_bitmap, rasterizer->BlitBuffer.Data, (uint32_t)info.Width, rasterizer->MultiplyEnabled ? rasterizer->MultiplyTable : NULL);
+    for (int n = 0; n < pixel_count; n++)
+        out_glyph->Pixels[n] = (unsigned char)((rasterizer->BlitBuffer[n] >> IM_COL32_A_SHIFT) & 0xFF);
+    return true;
+}
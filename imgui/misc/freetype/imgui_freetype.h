@@ -8,6 +8,7 @@
 // Forward declarations
 struct ImFontAtlas;
 struct ImFontBuilderIO;
+struct ImGuiFreeTypeRasterizer;     // Opaque, see ImGuiFreeType::CreateRasterizer()
 
 // Hinting greatly impacts visuals (and glyph sizes).
 // - By default, hinting is enabled and the font's native hinter is preferred over the auto-hinter.
@@ -27,7 +28,23 @@ enum ImGuiFreeTypeBuilderFlags
     ImGuiFreeTypeBuilderFlags_Oblique       = 1 << 6,   // Styling: Should we slant the font, emulating italic style?
     ImGuiFreeTypeBuilderFlags_Monochrome    = 1 << 7,   // Disable anti-aliasing. Combine this with MonoHinting for best results!
     ImGuiFreeTypeBuilderFlags_LoadColor     = 1 << 8,   // Enable FreeType color-layered glyphs
-    ImGuiFreeTypeBuilderFlags_Bitmap        = 1 << 9    // Enable FreeType bitmap glyphs
+    ImGuiFreeTypeBuilderFlags_Bitmap        = 1 << 9,   // Enable FreeType bitmap glyphs
+    ImGuiFreeTypeBuilderFlags_SDF           = 1 << 10   // Render signed distance fields (FT_RENDER_MODE_SDF, spread IMGUI_FREETYPE_SDF_SPREAD) instead of coverage. The outline sits at alpha 128; draw with a renderer that thresholds the font texture (e.g. ImGui_ImplOpenGL3_SetFontTextureSdf()). RasterizerMultiply is ignored.
+};
+
+// Distance in pixels covered by the 0..255 range of ImGuiFreeTypeBuilderFlags_SDF glyphs, on each side of the outline.
+// Glyph bitmaps grow by this many pixels on every side. FreeType accepts 2..32; 4 is enough to draw down to a quarter of the rasterized size.
+#ifndef IMGUI_FREETYPE_SDF_SPREAD
+#define IMGUI_FREETYPE_SDF_SPREAD   4
+#endif
+
+// A single glyph rendered by ImGuiFreeType::RasterizeGlyph() (8-bit alpha, RasterizerMultiply applied)
+struct ImGuiFreeTypeGlyph
+{
+    int                     Width, Height;      // Bitmap size in pixels
+    float                   OffsetX, OffsetY;   // Distance from the pen position to the top-left corner of the bitmap
+    float                   AdvanceX;           // Distance from the pen position to the next glyph
+    ImVector<unsigned char> Pixels;             // Width * Height alpha values, row after row
 };
 
 namespace ImGuiFreeType
@@ -42,6 +59,19 @@ namespace ImGuiFreeType
     // However, as FreeType does lots of allocations we provide a way for the user to redirect it to a separate memory heap if desired.
     IMGUI_API void                      SetAllocatorFunctions(void* (*alloc_func)(size_t sz, void* user_data), void (*free_func)(void* ptr, void* user_data), void* user_data = NULL);
 
+    // Number of threads rasterizing glyphs during the atlas build. 0 (default): one per hardware thread, 1: calling thread only.
+    // Extra threads use their own FT_Face and allocate with malloc(). Packing and the final texture don't depend on this setting.
+    IMGUI_API void                      SetBuilderThreadCount(int thread_count);
+
+    // Rasterize glyphs one at a time, for atlases that are filled on demand instead of by ImFontAtlas::Build().
+    // - A rasterizer is bound to one ImFontConfig source and keeps its own FT_Library/FT_Face, cfg->FontData must outlive it.
+    // - Color glyphs (ImGuiFreeTypeBuilderFlags_LoadColor) are reduced to their alpha channel.
+    IMGUI_API ImGuiFreeTypeRasterizer*  CreateRasterizer(const ImFontConfig* cfg, unsigned int extra_flags = 0);
+    IMGUI_API void                      DestroyRasterizer(ImGuiFreeTypeRasterizer* rasterizer);
+    IMGUI_API void                      GetRasterizerMetrics(ImGuiFreeTypeRasterizer* rasterizer, float* out_ascent, float* out_descent);
+    IMGUI_API bool                      HasGlyph(ImGuiFreeTypeRasterizer* rasterizer, ImWchar codepoint);
+    IMGUI_API bool                      RasterizeGlyph(ImGuiFreeTypeRasterizer* rasterizer, ImWchar codepoint, ImGuiFreeTypeGlyph* out_glyph);
+
     // Obsolete names (will be removed soon)
     // Prefer using '#define IMGUI_ENABLE_FREETYPE'
 #ifndef IMGUI_DISABLE_OBSOLETE_FUNCTIONS
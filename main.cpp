@@ -6,8 +6,155 @@
 #include "MainWindow.h"
 #include "main.h"
 
-void main()
+void main(int argc, char* argv[])
 {
+    // --headless --frames N : render N frames offscreen and print frame timings.
+    // --pipelined           : submit GL commands from a separate render thread.
+    // --dynamic-fonts       : rasterize glyphs on first use.
+    // --sdf-fonts           : signed distance field glyphs, any size from one rasterization.
+    // --stream-buffers[=map]: upload each frame through one persistently mapped
+    //                         (or glMapBufferRange) ring instead of glBufferData per list.
+    // --merge-draws         : merge compatible draw commands, skip redundant GL state changes.
+    // --bench-fonts         : time the font atlas build on one and on all cores, then exit.
+    // --bench-events        : time the event queue lists at several depths, then exit.
+    // --event-workers N     : dispatch events on N threads, sharded by ordering key.
+    // --queue-bound T,C,P   : at most C events of type T pending, P = block, drop-oldest,
+    //                         drop-newest or coalesce beyond; C = 0 removes the bound.
+    // --journal FILE        : record every queued event to the journal FILE, appending
+    //                         to it if it exists.
+    // --replay FILE         : feed the events of journal FILE through the event queue,
+    // --replay-speed X      : X times faster than recorded (0: at once, default 1),
+    //                         print the latency summary, then exit.
+    // --bridge PATH         : serve the event bridge on the Unix domain socket PATH.
+    // --bench-bridge        : time commands and status updates through the bridge, then exit.
+    bool headless = false;
+    bool pipelined = false;
+    bool dynamicFonts = false;
+    bool sdfFonts = false;
+    int streamMode = ImGui_ImplOpenGL3_StreamMode_BufferData;
+    bool drawOptimizer = false;
+    int frames = 300;
+    int eventWorkers = 0;
+    struct QueueBoundArg
+    {
+        int type;
+        int capacity;
+        int overflow;
+    };
+    std::vector<QueueBoundArg> queueBounds;
+    std::string journalPath;
+    std::string replayPath;
+    std::string bridgePath;
+    double replaySpeed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--pipelined")
+        {
+            pipelined = true;
+        }
+        else if (arg == "--dynamic-fonts")
+        {
+            dynamicFonts = true;
+        }
+        else if (arg == "--sdf-fonts")
+        {
+            sdfFonts = true;
+        }
+        else if (arg == "--stream-buffers")
+        {
+            streamMode = ImGui_ImplOpenGL3_StreamMode_Persistent;
+        }
+        else if (arg == "--stream-buffers=map")
+        {
+            streamMode = ImGui_ImplOpenGL3_StreamMode_MapRange;
+        }
+        else if (arg == "--merge-draws")
+        {
+            drawOptimizer = true;
+        }
+        else if (arg == "--bench-fonts")
+        {
+            MainGUIWindow::BenchmarkFontBuild(stdout);
+            return;
+        }
+        else if (arg == "--bench-events")
+        {
+            Events::BenchmarkQueues(stdout);
+            return;
+        }
+        else if (arg == "--bench-bridge")
+        {
+            EventBridge::Benchmark(stdout);
+            return;
+        }
+        else if (arg == "--event-workers" && i + 1 < argc)
+        {
+            eventWorkers = atoi(argv[++i]);
+            if (eventWorkers < 0)
+            {
+                eventWorkers = 0;
+            }
+        }
+        else if (arg == "--queue-bound" && i + 1 < argc)
+        {
+            QueueBoundArg bound = { 0, 0, -1 };
+            char policy[32] = "";
+            if (sscanf(argv[++i], "%d,%d,%31s", &bound.type, &bound.capacity, policy) == 3)
+            {
+                for (int overflow = constants::QUEUE_OVERFLOW_BLOCK; overflow <= constants::QUEUE_OVERFLOW_COALESCE; ++overflow)
+                {
+                    if (strcmp(policy, Events::OverflowName(overflow)) == 0)
+                    {
+                        bound.overflow = overflow;
+                    }
+                }
+            }
+            if (bound.overflow < 0)
+            {
+                printf("--queue-bound expects type,capacity,block|drop-oldest|drop-newest|coalesce\n");
+                return;
+            }
+            queueBounds.push_back(bound);
+        }
+        else if (arg == "--journal" && i + 1 < argc)
+        {
+            journalPath = argv[++i];
+        }
+        else if (arg == "--bridge" && i + 1 < argc)
+        {
+            bridgePath = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+        else if (arg == "--replay-speed" && i + 1 < argc)
+        {
+            replaySpeed = atof(argv[++i]);
+            if (replaySpeed < 0)
+            {
+                replaySpeed = 0;
+            }
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            frames = atoi(argv[++i]);
+            if (frames < 1)
+            {
+                frames = 1;
+            }
+        }
+    }
+    if (!replayPath.empty())
+    {
+        Events::ReplayJournal(replayPath.c_str(), replaySpeed, eventWorkers, stdout);
+        return;
+    }
     { // ,   
       //    .        
         //setlocale(LC_ALL, "ru_RU.utf8");
@@ -25,11 +172,33 @@ void main()
         
         //   
         events = std::shared_ptr <Events>(new Events());
+        for (const QueueBoundArg& bound : queueBounds)
+        {
+            events->SetQueueBound(bound.type, bound.capacity, bound.overflow);
+        }
+        if (!journalPath.empty() && !events->journal.Open(journalPath.c_str(), constants::EVENT_JOURNAL_RECORDS))
+        {
+            spdlog::warn("Cannot open the event journal {}.", journalPath);
+        }
         //  GUI
         gui = std::shared_ptr<MainGUIWindow>(new MainGUIWindow(*events));
+        if (headless)
+        {
+            gui->headless = true;
+            gui->maxFrames = frames;
+        }
+        gui->pipelinedRendering = pipelined;
+        gui->dynamicFonts = dynamicFonts;
+        gui->sdfFonts = sdfFonts;
+        gui->streamMode = streamMode;
+        gui->drawOptimizer = drawOptimizer;
 
         //    
-        events->Run();
+        events->Run(eventWorkers);
+        if (!bridgePath.empty())
+        {
+            events->bridge.Start(bridgePath.c_str());
+        }
         //  GUI
         gui->Run();
 
@@ -8,6 +8,8 @@
 #include <chrono>
 #include <vector>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <locale>
 #include <codecvt>
 #ifdef _WIN32